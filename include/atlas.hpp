@@ -0,0 +1,27 @@
+#ifndef ATLAS_HPP
+#define ATLAS_HPP
+
+#include <optional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Quadtree allocator for square power of two tiles in a square atlas, freed siblings merge back into their parent
+class Atlas {
+public:
+    Atlas(std::uint32_t, std::uint32_t);
+    ~Atlas();
+
+    std::optional<glm::uvec2>               Allocate(std::uint32_t);
+    void                                    Free(const glm::uvec2 &, std::uint32_t);
+
+    std::uint32_t                           m_MinSize;
+    std::uint32_t                           m_Size;
+
+private:
+    size_t                                  Level(std::uint32_t) const;
+
+    std::vector<std::vector<glm::uvec2>>    m_FreeNodes;
+};
+
+#endif /* ATLAS_HPP */
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "render.hpp"
+
+struct BenchmarkFrame {
+    float                                   m_Time;
+    std::vector<ProfilerSample>             m_Samples;
+};
+
+class Benchmark {
+public:
+    Benchmark(const std::filesystem::path &, unsigned int);
+    ~Benchmark();
+
+    bool                                    IsFinished() const;
+    void                                    Record();
+    void                                    Update();
+    bool                                    Write() const;
+
+    std::filesystem::path                   m_Filename;
+    unsigned int                            m_NumFrames;
+
+private:
+    std::chrono::steady_clock::time_point   m_FrameBegin;
+    std::vector<BenchmarkFrame>             m_Frames;
+    unsigned int                            m_NumUpdates;
+};
+
+extern std::unique_ptr<Benchmark> g_Benchmark;
+
+#endif /* BENCHMARK_HPP */
\ No newline at end of file
@@ -1,10 +1,14 @@
 #ifndef BUFFER_HPP
 #define BUFFER_HPP
 
+#include <array>
+#include <cstdint>
 #include <vector>
 
 #include <GL/glew.h> 
 
+constexpr size_t RING_BUFFER_NUM_FRAMES = 3;
+
 template<typename T> 
 class Buffer {
 public:
@@ -12,9 +16,14 @@ public:
     Buffer(GLsizei count);
     ~Buffer();
 
+    void    BindElement() const;
+    void    BindParameter() const;
     void    BindStorage(GLuint) const;
+    void    Clear() const;
     void    Copy(const Buffer<T> *, GLintptr, GLintptr, GLsizeiptr) const;
+    void    Download(T *, GLsizei, GLsizei) const;
     void    Upload(const T &, GLsizei) const;
+    void    Upload(const T *, GLsizei, GLsizei) const;
     void    Upload(const std::vector<T> &, GLsizei) const;
 
     GLuint  m_Handle;
@@ -34,37 +43,148 @@ inline Buffer<T>::~Buffer() {
     glDeleteBuffers(1, &m_Handle);
 }
 
+template<typename T> 
+inline void Buffer<T>::BindElement() const {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Handle);
+}
+
+template<typename T> 
+inline void Buffer<T>::BindParameter() const {
+    glBindBuffer(GL_PARAMETER_BUFFER, m_Handle);
+}
+
 template<typename T> 
 inline void Buffer<T>::BindStorage(GLuint binding) const {
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, m_Handle);
 }
 
+template<typename T> 
+inline void Buffer<T>::Clear() const {
+    glClearNamedBufferData(m_Handle, GL_R8UI, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+}
+
 template<typename T> 
 inline void Buffer<T>::Copy(const Buffer<T> *dst, GLintptr srcFirst, GLintptr dstFirst, GLsizeiptr count) const {
     glCopyNamedBufferSubData(m_Handle, dst->m_Handle, srcFirst * sizeof(T), dstFirst * sizeof(T), count * sizeof(T));
 }
 
+template<typename T> 
+inline void Buffer<T>::Download(T *data, GLsizei count, GLsizei first) const {
+    glGetNamedBufferSubData(m_Handle, static_cast<size_t>(first) * sizeof(T), static_cast<size_t>(count) * sizeof(T), data);
+}
+
 template<typename T> 
 inline void Buffer<T>::Upload(const T &data, GLsizei first) const {
     glNamedBufferSubData(m_Handle, static_cast<size_t>(first) * sizeof(T), sizeof(T), &data);
 }
 
+template<typename T> 
+inline void Buffer<T>::Upload(const T *data, GLsizei count, GLsizei first) const {
+    glNamedBufferSubData(m_Handle, static_cast<size_t>(first) * sizeof(T), static_cast<size_t>(count) * sizeof(T), data);
+}
+
 template<typename T> 
 inline void Buffer<T>::Upload(const std::vector<T> &data, GLsizei first) const {
     glNamedBufferSubData(m_Handle, static_cast<size_t>(first) * sizeof(T), data.size() * sizeof(T), data.data());
 }
 
-struct DrawIndirectCommand {
-    GLuint m_NumVertices;
+// Persistently mapped storage split into one region per frame in flight, the CPU writes the current region in place
+template<typename T>
+class RingBuffer {
+public:
+    RingBuffer() : RingBuffer(1) {};
+    RingBuffer(GLsizei count);
+    ~RingBuffer();
+
+    void                                            BindStorage(GLuint) const;
+    void                                            Fence();
+    T *                                             Map();
+
+    GLuint                                          m_Handle;
+    GLsizei                                         m_Count;
+
+private:
+    std::uint8_t *                                  m_Data;
+    std::array<GLsync, RING_BUFFER_NUM_FRAMES>      m_Fences;
+    size_t                                          m_Frame;
+    GLsizeiptr                                      m_Stride;
+};
+
+template<typename T>
+inline RingBuffer<T>::RingBuffer(GLsizei count) {
+    auto alignment = 0;
+
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    // Regions start on the storage binding alignment so each one can be bound as a range
+    const auto flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const auto size = static_cast<GLsizeiptr>(count) * sizeof(T);
+
+    m_Stride = (size + alignment - 1) / alignment * alignment;
+
+    glCreateBuffers(1, &m_Handle);
+    glNamedBufferStorage(m_Handle, m_Stride * RING_BUFFER_NUM_FRAMES, nullptr, flags);
+
+    m_Count = count;
+    m_Data = static_cast<std::uint8_t *>(glMapNamedBufferRange(m_Handle, 0, m_Stride * RING_BUFFER_NUM_FRAMES, flags));
+    m_Fences = {};
+    m_Frame = 0;
+}
+
+template<typename T>
+inline RingBuffer<T>::~RingBuffer() {
+    for (const auto &fence : m_Fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+
+    glUnmapNamedBuffer(m_Handle);
+    glDeleteBuffers(1, &m_Handle);
+}
+
+template<typename T> 
+inline void RingBuffer<T>::BindStorage(GLuint binding) const {
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, m_Handle, m_Frame * m_Stride, static_cast<GLsizeiptr>(m_Count) * sizeof(T));
+}
+
+template<typename T> 
+inline void RingBuffer<T>::Fence() {
+    if (m_Fences[m_Frame]) {
+        glDeleteSync(m_Fences[m_Frame]);
+    }
+
+    m_Fences[m_Frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+template<typename T> 
+inline T *RingBuffer<T>::Map() {
+    m_Frame = (m_Frame + 1) % RING_BUFFER_NUM_FRAMES;
+
+    // Only blocks when the GPU is still reading this region from RING_BUFFER_NUM_FRAMES frames ago
+    if (m_Fences[m_Frame]) {
+        while (glClientWaitSync(m_Fences[m_Frame], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+
+        glDeleteSync(m_Fences[m_Frame]);
+
+        m_Fences[m_Frame] = nullptr;
+    }
+
+    return reinterpret_cast<T *>(m_Data + m_Frame * m_Stride);
+}
+
+struct DrawElementsIndirectCommand {
+    GLuint m_NumIndices;
     GLuint m_NumInstances;
-    GLuint m_FirstVertex;
+    GLuint m_FirstIndex;
+    GLint  m_BaseVertex;
     GLuint m_FirstInstance;
 };
 
-class DrawIndirectBuffer : public Buffer<DrawIndirectCommand> {
+class DrawIndirectBuffer : public Buffer<DrawElementsIndirectCommand> {
 public:
-    DrawIndirectBuffer() : Buffer<DrawIndirectCommand>(1) {};
-    DrawIndirectBuffer(GLsizei count) : Buffer<DrawIndirectCommand>(count) {};
+    DrawIndirectBuffer() : Buffer<DrawElementsIndirectCommand>(1) {};
+    DrawIndirectBuffer(GLsizei count) : Buffer<DrawElementsIndirectCommand>(count) {};
 
     void    BindIndirect() const;
 };
@@ -0,0 +1,77 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+#include "vertex.hpp"
+
+constexpr std::uint32_t MODEL_CACHE_VERSION = 6;
+constexpr size_t        MODEL_CACHE_PATH_SIZE = 256;
+
+struct ModelCacheHeader {
+    char            m_Magic[4];
+    std::uint32_t   m_Version;
+    std::uint64_t   m_SourceHash;
+    std::int64_t    m_SourceTime;
+    std::uint64_t   m_SourceSize;
+    std::uint32_t   m_NumIndices;
+    std::uint32_t   m_NumMaterials;
+    std::uint32_t   m_NumMeshes;
+    std::uint32_t   m_NumMeshlets;
+    std::uint32_t   m_NumVertices;
+};
+
+struct ModelCacheMaterial {
+    char            m_DiffuseImage[MODEL_CACHE_PATH_SIZE];
+    char            m_MetalnessImage[MODEL_CACHE_PATH_SIZE];
+    char            m_NormalImage[MODEL_CACHE_PATH_SIZE];
+    char            m_RoughnessImage[MODEL_CACHE_PATH_SIZE];
+};
+
+struct ModelCacheMesh {
+    glm::vec3       m_BoundsMax;
+    glm::vec3       m_BoundsMin;
+    std::uint32_t   m_FirstIndex;
+    std::uint32_t   m_NumIndices;
+    std::uint32_t   m_FirstVertex;
+    std::uint32_t   m_NumVertices;
+    std::uint32_t   m_Material;
+    std::uint32_t   m_NumLods;
+    MeshLod         m_Lods[MESH_MAX_LODS];
+};
+
+// Cooked model: header, materials, meshes, meshlets, positions, attributes and indices packed back to back
+// Indices are already offset by the first vertex of their mesh, positions are quantized to its bounds
+class ModelCache {
+public:
+    ModelCache(const std::filesystem::path &, const ModelCacheHeader &);
+    ModelCache(std::vector<char> &&);
+    ~ModelCache();
+
+    static std::vector<char>                Cook(const ModelCacheHeader &, const std::vector<ModelCacheMaterial> &, const std::vector<Mesh> &);
+    static bool                             Save(const std::filesystem::path &, const std::vector<char> &);
+    static ModelCacheHeader                 Source(const std::filesystem::path &);
+
+    const VertexAttributes *                Attributes() const;
+    const ModelCacheHeader *                Header() const;
+    const std::uint32_t *                   Indices() const;
+    bool                                    IsValid() const;
+    const ModelCacheMaterial *              Materials() const;
+    const ModelCacheMesh *                  Meshes() const;
+    const Meshlet *                         Meshlets() const;
+    const VertexPosition *                  Positions() const;
+
+private:
+    const char *                            m_Data;
+    void *                                  m_Mapping;
+    std::vector<char>                       m_Memory;
+    size_t                                  m_Size;
+};
+
+std::uint64_t ComputeHash(const std::string &);
+
+#endif /* CACHE_HPP */
\ No newline at end of file
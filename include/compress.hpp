@@ -0,0 +1,15 @@
+#ifndef COMPRESS_HPP
+#define COMPRESS_HPP
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Texels of a 4x4 block in row-major order
+typedef glm::u8vec4 CompressBlock[16];
+
+void CompressBC4(const CompressBlock &, std::uint8_t (&)[8]);
+void CompressBC5(const CompressBlock &, std::uint8_t (&)[16]);
+void CompressBC7(const CompressBlock &, std::uint8_t (&)[16]);
+
+#endif /* COMPRESS_HPP */
\ No newline at end of file
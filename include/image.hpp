@@ -1,10 +1,19 @@
 #ifndef IMAGE_HPP
 #define IMAGE_HPP
 
+#include <cstdint>
 #include <filesystem>
+#include <tuple>
+#include <vector>
 
 #include <glm/glm.hpp>
 
+enum struct ImageCompression : std::uint32_t {
+    BC4,
+    BC5,
+    BC7,
+};
+
 class Image {
 public:
     Image(const std::filesystem::path &);
@@ -19,4 +28,25 @@ public:
     void *          m_Data;
 };
 
+// Block compressed image with its full mip chain, cooked once into a KTX2 style file in the cache directory
+class CompressedImage {
+public:
+    CompressedImage(const std::filesystem::path &, ImageCompression);
+    ~CompressedImage();
+
+    const void *                                Level(unsigned int) const;
+    unsigned int                                LevelSize(unsigned int) const;
+    unsigned int                                MipLevel() const;
+
+    ImageCompression                            m_Compression;
+    std::vector<char>                           m_Data;
+    unsigned int                                m_Height;
+    std::vector<std::tuple<size_t, size_t>>     m_Levels;
+    unsigned int                                m_Width;
+
+private:
+    void                                        Compress(const Image &);
+    bool                                        Parse();
+};
+
 #endif /* IMAGE_HPP */
\ No newline at end of file
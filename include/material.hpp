@@ -1,13 +1,15 @@
 #ifndef MATERIAL_HPP
 #define MATERIAL_HPP
 
+#include <memory>
+
 #include "image.hpp"
 
 struct Material {
-    std::shared_ptr<Image> m_DiffuseImage;
-    std::shared_ptr<Image> m_MetalnessImage;
-    std::shared_ptr<Image> m_NormalImage;
-    std::shared_ptr<Image> m_RoughnessImage;
+    std::shared_ptr<CompressedImage> m_DiffuseImage;
+    std::shared_ptr<CompressedImage> m_MetalnessImage;
+    std::shared_ptr<CompressedImage> m_NormalImage;
+    std::shared_ptr<CompressedImage> m_RoughnessImage;
 };
 
 #endif /* MATERIAL_HPP */
\ No newline at end of file
@@ -5,13 +5,51 @@
 
 #include "vertex.hpp"
 
+constexpr size_t MESH_MAX_LODS = 4;
+
+// Index range of one level of detail and its geometric error in model units
+struct MeshLod {
+    glm::u32        m_FirstIndex;
+    glm::u32        m_NumIndices;
+    float           m_Error;
+};
+
+// Contiguous run of triangles with its bounding sphere and normal cone, indices are relative to the mesh until cooked
+struct Meshlet {
+    glm::vec3       m_Center;
+    float           m_Radius;
+    glm::vec3       m_ConeAxis;
+    float           m_ConeCutoff;
+    glm::u32        m_FirstIndex;
+    glm::u32        m_NumIndices;
+    glm::u32        m_Mesh;
+    glm::u32        m_Padding0;
+};
+
 class Mesh {
 public:
-    Mesh(std::vector<Vertex>, std::vector<unsigned int>);
+    Mesh(std::vector<Vertex>, std::vector<unsigned int>, unsigned int);
     ~Mesh();
 
+    // Appends simplified index ranges at 1/2, 1/4 and 1/8 of the triangles, they share the vertices
+    void                        BuildLods();
+    void                        BuildMeshlets();
+    // Deduplicates vertices, then reorders for the post-transform cache, overdraw and fetch locality
+    void                        Optimize();
+
     std::vector<unsigned int>   m_Indices;
+    std::vector<MeshLod>        m_Lods;
+    unsigned int                m_Material;
+    std::vector<Meshlet>        m_Meshlets;
     std::vector<Vertex>         m_Vertices;
+
+private:
+    Meshlet                     ComputeMeshletBounds(size_t, size_t) const;
+    void                        DeduplicateVertices();
+    void                        OptimizeOverdraw(const std::vector<size_t> &);
+    std::vector<size_t>         OptimizeVertexCache(std::vector<unsigned int> &) const;
+    void                        OptimizeVertexFetch();
+    std::vector<unsigned int>   Simplify(const std::vector<unsigned int> &, size_t, float &) const;
 };
 
 #endif /* MESH_HPP */
\ No newline at end of file
@@ -2,21 +2,24 @@
 #define MODEL_HPP
 
 #include <filesystem>
+#include <memory>
 #include <vector>
 
+#include "cache.hpp"
 #include "material.hpp"
-#include "mesh.hpp"
 
 class Model {
 public:
     Model(const std::filesystem::path &filename);
     ~Model();
 
-    size_t                  NumIndices() const;
-    size_t                  NumVertices() const;
+    size_t                              NumIndices() const;
+    size_t                              NumMeshes() const;
+    size_t                              NumMeshlets() const;
+    size_t                              NumVertices() const;
 
-    std::vector<Material>   m_Materials;
-    std::vector<Mesh>       m_Meshes;
+    std::unique_ptr<const ModelCache>   m_Cache;
+    std::vector<Material>               m_Materials;
 };
 
 #endif /* MODEL_HPP */
\ No newline at end of file
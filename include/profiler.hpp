@@ -0,0 +1,65 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h> 
+
+constexpr size_t PROFILER_MAX_SCOPES = 32;
+constexpr size_t PROFILER_NUM_FRAMES = 4;
+constexpr size_t PROFILER_NUM_SAMPLES = 128;
+
+struct ProfilerSample {
+    const char *                                                m_Name;
+    float                                                       m_Time;
+};
+
+struct ProfilerStatistics {
+    const char *                                                m_Name;
+    float                                                       m_Avg;
+    float                                                       m_Min;
+    float                                                       m_P99;
+};
+
+struct ProfilerScope {
+    const char *                                                m_Name;
+    size_t                                                      m_NumSamples;
+    std::array<float, PROFILER_NUM_SAMPLES>                     m_Samples;
+};
+
+struct ProfilerFrame {
+    std::uint32_t                                               m_Frame;
+    size_t                                                      m_NumScopes;
+    bool                                                        m_Pending;
+    std::array<size_t, PROFILER_MAX_SCOPES>                     m_Scopes;
+};
+
+// Brackets scopes with GL_TIMESTAMP queries and reads them back a few frames later, so it never stalls
+class Profiler {
+public:
+    Profiler();
+    ~Profiler();
+
+    void                                                        Begin(const char *);
+    void                                                        BeginFrame(std::uint32_t);
+    void                                                        End();
+    void                                                        EndFrame();
+    void                                                        Resolve();
+    std::vector<ProfilerStatistics>                             Statistics() const;
+
+    std::uint32_t                                               m_LastFrame;
+    std::vector<ProfilerSample>                                 m_LastSamples;
+
+private:
+    size_t                                                      FindScope(const char *);
+
+    size_t                                                      m_CurrentFrame;
+    std::array<ProfilerFrame, PROFILER_NUM_FRAMES>              m_Frames;
+    std::vector<size_t>                                         m_OpenScopes;
+    std::array<GLuint, PROFILER_NUM_FRAMES * PROFILER_MAX_SCOPES * 2>  m_Queries;
+    std::vector<ProfilerScope>                                  m_Scopes;
+};
+
+#endif /* PROFILER_HPP */
\ No newline at end of file
@@ -3,14 +3,17 @@
 
 #include <array>
 #include <memory>
+#include <vector>
 
 #include <GL/glew.h> 
 #include <SDL2/SDL_video.h>
 
+#include "atlas.hpp"
 #include "buffer.hpp"
 #include "framebuffer.hpp"
 #include "light.hpp"
 #include "model.hpp"
+#include "profiler.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
 
@@ -35,6 +38,12 @@ inline DrawFlags &operator&=(DrawFlags &a, const DrawFlags b) {
     return a = a & b;
 }
 
+enum struct AmbientOcclusionResolution : std::uint32_t {
+    Full = 0,
+    Half = 1,
+    Quarter = 2,
+};
+
 struct GpuCamera {
     glm::mat4   m_LastView;
     glm::mat4   m_Projection;
@@ -52,6 +61,8 @@ struct GpuCamera {
     float       m_FovY;
     float       m_SliceBiasFactor;
     float       m_SliceScalingFactor;
+    glm::uvec2  m_RenderExtent;
+    glm::uvec2  m_LastRenderExtent;
     float       m_Padding1;
     float       m_Padding2;
 };
@@ -98,7 +109,42 @@ struct GpuMaterial {
     GLuint  m_RoughnessMap;
 };
 
-typedef Vertex GpuVertex;
+struct GpuMesh {
+    glm::vec3                               m_BoundsMax;
+    GLuint                                  m_Material;
+    glm::vec3                               m_BoundsMin;
+    GLuint                                  m_NumLods;
+    glm::vec4                               m_LodErrors;
+    std::array<glm::uvec2, MESH_MAX_LODS>   m_LodRanges;
+};
+
+typedef Meshlet GpuMeshlet;
+
+struct GpuShadowCube {
+    std::array<glm::vec4, 6>    m_AtlasRects;
+};
+
+struct GpuShadowView {
+    glm::mat4   m_ViewProjection;
+    float       m_Resolution;
+    float       m_Padding0;
+    float       m_Padding1;
+    float       m_Padding2;
+};
+
+typedef VertexAttributes GpuVertexAttributes;
+typedef VertexPosition GpuVertexPosition;
+
+struct ShadowCubeSlot {
+    std::uint32_t               m_AtlasGeneration;
+    std::array<glm::uvec2, 6>   m_AtlasOffsets;
+    GLuint                      m_AtlasSize;
+    const LightPoint *          m_LightPoint;
+    glm::vec3                   m_Position;
+    float                       m_Radius;
+    GLuint                      m_RequestedSize;
+    bool                        m_IsDirty;
+};
 
 class Render {
 public:
@@ -113,23 +159,39 @@ public:
     std::int32_t                                            m_AmbientOcclusionNumSamples;
     std::int32_t                                            m_AmbientOcclusionNumSlices;
     float                                                   m_AmbientOcclusionRadius;
+    AmbientOcclusionResolution                              m_AmbientOcclusionResolution;
+    glm::uvec3                                              m_ClusterGridSize;
     SDL_GLContext                                           m_Context;
     DrawFlags                                               m_DrawFlags;
     const Camera *                                          m_DrawableActiveCamera;
     const LightEnvironment *                                m_DrawableLightEnvironment;
     std::vector<const LightPoint *>                         m_DrawableLightPoints;
     bool                                                    m_EnableAmbientOcclusion;
+    bool                                                    m_EnableAmbientOcclusionInterleaving;
+    bool                                                    m_EnableAutoClusterGridSize;
+    bool                                                    m_EnableConeCulling;
+    bool                                                    m_EnableDynamicResolution;
+    bool                                                    m_EnableFrustumCulling;
+    bool                                                    m_EnableOcclusionCulling;
     bool                                                    m_EnableReverseZ;
     bool                                                    m_EnableVSync;
     bool                                                    m_EnableWireframeMode;
+    float                                                   m_LodThreshold;
+    std::unique_ptr<Profiler>                               m_Profiler;
+    float                                                   m_RenderScale;
     float                                                   m_ShadowCsmFilterRadius;
     float                                                   m_ShadowCsmVarianceMax;
     float                                                   m_ShadowCubeFilterRadius;
     float                                                   m_ShadowCubeVarianceMax;
+    float                                                   m_TargetFrameTime;
 
 private:
+    void                                                    Resize(const glm::uvec2 &);
+    void                                                    ShadowCullingPass();
     void                                                    ShadowCsmPass();
     void                                                    ShadowCubePass();
+    void                                                    MeshCullingPass();
+    void                                                    MeshletCullingPass();
     void                                                    DepthPass();
     void                                                    DownsampleDepthPass();
     void                                                    AmbientOcclusionPass();
@@ -138,65 +200,110 @@ private:
     void                                                    ClusterPass();
     void                                                    LightCullingPass();
     void                                                    LightingPass();
+    void                                                    UpscalePass();
     void                                                    ScreenPass();
     
     std::unique_ptr<const Framebuffer>                      m_AmbientOcclusionFramebuffer;
     std::unique_ptr<const ShaderProgram>                    m_AmbientOcclusionShaderProgram;
     std::unique_ptr<const Texture2D>                        m_AmbientOcclusionTexture2D;
+    std::vector<std::unique_ptr<const TextureView2D>>       m_AmbientOcclusionTextureView2Ds;
     std::unique_ptr<const Framebuffer>                      m_AmbientOcclusionSpartialFramebuffer;
     std::unique_ptr<const ShaderProgram>                    m_AmbientOcclusionSpartialShaderProgram;
     std::unique_ptr<const Texture2D>                        m_AmbientOcclusionSpartialTexture2D;
+    std::vector<std::unique_ptr<const TextureView2D>>       m_AmbientOcclusionSpartialTextureView2Ds;
     std::unique_ptr<const Framebuffer>                      m_AmbientOcclusionTemporalFramebuffer;
     std::unique_ptr<const ShaderProgram>                    m_AmbientOcclusionTemporalShaderProgram;
     std::unique_ptr<const Texture2D>                        m_AmbientOcclusionTemporalTexture2D;
-    std::unique_ptr<const Buffer<GpuCamera>>                m_CameraBuffer;
+    std::vector<std::unique_ptr<const TextureView2D>>       m_AmbientOcclusionTemporalTextureView2Ds;
+    std::unique_ptr<const Buffer<GpuVertexAttributes>>      m_AttributeBuffer;
+    std::unique_ptr<RingBuffer<GpuCamera>>                  m_CameraBuffer;
     std::unique_ptr<const Buffer<GpuCluster>>               m_ClusterBuffer;
     std::unique_ptr<const ShaderProgram>                    m_ClusterShaderProgram;
+    bool                                                    m_ClusterUpdate;
+    std::unique_ptr<const DrawIndirectBuffer>               m_CulledDrawIndirectBuffer;
     std::unique_ptr<const Framebuffer>                      m_DepthFramebuffer;
     std::unique_ptr<const ShaderProgram>                    m_DepthShaderProgram;
     std::unique_ptr<const Texture2D>                        m_DepthTexture2D;
-    std::vector<std::unique_ptr<const TextureView2D>>       m_DepthTextureView2Ds;
     std::unique_ptr<const Texture2DArray>                   m_DiffuseTexture2DArray;
-    std::unique_ptr<const Framebuffer>                      m_DownsampleDepthFramebuffer;
+    std::unique_ptr<const Buffer<std::uint32_t>>            m_DownsampleDepthCounterBuffer;
     std::unique_ptr<const ShaderProgram>                    m_DownsampleDepthShaderProgram;
     std::unique_ptr<const DrawIndirectBuffer>               m_DrawIndirectBuffer;
+    std::array<float, 2>                                    m_FrameTimeErrors;
+    std::unique_ptr<const Texture2D>                        m_HiZTexture2D;
+    std::vector<std::unique_ptr<const TextureView2D>>       m_HiZTextureView2Ds;
     std::unique_ptr<const Buffer<GpuIndex>>                 m_IndexBuffer;
+    bool                                                    m_IsHistoryValid;
+    glm::vec2                                               m_Jitter;
+    AmbientOcclusionResolution                              m_LastAmbientOcclusionResolution;
     std::unique_ptr<const Texture2D>                        m_LastAmbientOcclusionTemporalTexture2D;
+    std::vector<std::unique_ptr<const TextureView2D>>       m_LastAmbientOcclusionTemporalTextureView2Ds;
+    glm::uvec3                                              m_LastClusterGridSize;
+    glm::mat4                                               m_LastClusterProjection;
     std::unique_ptr<const Framebuffer>                      m_LastDepthFramebuffer;
     std::unique_ptr<const Texture2D>                        m_LastDepthTexture2D;
-    std::vector<std::unique_ptr<const TextureView2D>>       m_LastDepthTextureView2Ds;
-    std::unique_ptr<const ShaderProgram>                    m_LastDownsampleDepthFramebuffer;
+    bool                                                    m_LastEnableAmbientOcclusionInterleaving;
+    bool                                                    m_LastEnableReverseZ;
+    std::unique_ptr<const Texture2D>                        m_LastHiZTexture2D;
+    std::vector<std::unique_ptr<const TextureView2D>>       m_LastHiZTextureView2Ds;
     std::unique_ptr<const Framebuffer>                      m_LastLightingFramebuffer;
+    std::uint32_t                                           m_LastProfilerFrame;
+    glm::uvec2                                              m_LastRenderExtent;
+    std::unique_ptr<const Texture2D>                        m_LastUpscaleTexture2D;
     std::unique_ptr<const Buffer<std::uint32_t>>            m_LightCounterBuffer;
+    std::array<GLsync, 3>                                   m_LightCounterFences;
+    std::unique_ptr<const Buffer<std::uint32_t>>            m_LightCounterReadbackBuffer;
     std::unique_ptr<const ShaderProgram>                    m_LightCullingShaderProgram;
-    std::unique_ptr<const Buffer<GpuLightEnvironment>>      m_LightEnvironmentBuffer;
+    std::unique_ptr<RingBuffer<GpuLightEnvironment>>        m_LightEnvironmentBuffer;
     std::unique_ptr<const Buffer<GpuLightGrid>>             m_LightGridBuffer;
     std::unique_ptr<const Buffer<std::uint32_t>>            m_LightIndexBuffer;
-    std::unique_ptr<const Buffer<GpuLightPoint>>            m_LightPointBuffer;
+    std::unique_ptr<RingBuffer<GpuLightPoint>>              m_LightPointBuffer;
+    std::vector<std::int32_t>                               m_LightPointSlots;
     std::unique_ptr<const Framebuffer>                      m_LightingFramebuffer;
     std::unique_ptr<const ShaderProgram>                    m_LightingShaderProgram;
     std::unique_ptr<const Texture2D>                        m_LightingTexture2D;
     std::unique_ptr<const Buffer<GpuMaterial>>              m_MaterialBuffer;
+    std::unique_ptr<const Buffer<GpuMesh>>                  m_MeshBuffer;
+    std::unique_ptr<const ShaderProgram>                    m_MeshCullingShaderProgram;
     std::vector<std::tuple<GLuint, GLuint>>                 m_Meshes;
+    std::unique_ptr<const Buffer<GpuMeshlet>>               m_MeshletBuffer;
+    std::unique_ptr<const ShaderProgram>                    m_MeshletCullingShaderProgram;
+    std::unique_ptr<const Buffer<std::uint32_t>>            m_MeshletDrawCountBuffer;
+    std::unique_ptr<const DrawIndirectBuffer>               m_MeshletDrawIndirectBuffer;
     std::unique_ptr<const Texture2DArray>                   m_MetalnessTexture2DArray;
     std::unique_ptr<const Texture2DArray>                   m_NormalTexture2DArray;
     std::uint32_t                                           m_NumFrames;
+    glm::uvec2                                              m_PendingScreenExtent;
+    std::uint32_t                                           m_PendingScreenFrames;
+    std::unique_ptr<const Buffer<GpuVertexPosition>>        m_PositionBuffer;
+    glm::uvec2                                              m_RenderExtent;
     std::unique_ptr<const Texture2DArray>                   m_RoughnessTexture2DArray;
     std::unique_ptr<const Sampler>                          m_SamplerBorderWhite;
     std::unique_ptr<const Sampler>                          m_SamplerClamp;
     std::unique_ptr<const Sampler>                          m_SamplerWrap;
+    glm::uvec2                                              m_ScreenExtent;
     std::unique_ptr<const ShaderProgram>                    m_ScreenShaderProgram;
     std::unique_ptr<const Texture2DArray>                   m_ShadowCsmColorTexture2DArray;
     std::unique_ptr<const Texture2DArray>                   m_ShadowCsmDepthTexture2DArray;
     std::unique_ptr<const Framebuffer>                      m_ShadowCsmFramebuffer;
     std::unique_ptr<const ShaderProgram>                    m_ShadowCsmShaderProgram;
-    std::unique_ptr<const TextureCubeArray>                 m_ShadowCubeColorTextureCubeArray;
-    std::vector<std::unique_ptr<const TextureViewCube>>     m_ShadowCubeColorTextureViewCubes;
-    std::unique_ptr<const TextureCubeArray>                 m_ShadowCubeDepthTextureCubeArray;
-    std::vector<std::unique_ptr<const TextureViewCube>>     m_ShadowCubeDepthTextureViewCubes;
+    std::unique_ptr<Atlas>                                  m_ShadowCubeAtlas;
+    std::uint32_t                                           m_ShadowCubeAtlasGeneration;
+    std::unique_ptr<RingBuffer<GpuShadowCube>>              m_ShadowCubeBuffer;
+    std::unique_ptr<const Texture2D>                        m_ShadowCubeColorTexture2D;
+    std::unique_ptr<const Texture2D>                        m_ShadowCubeDepthTexture2D;
     std::unique_ptr<const Framebuffer>                      m_ShadowCubeFramebuffer;
     std::unique_ptr<const ShaderProgram>                    m_ShadowCubeShaderProgram;
-    std::unique_ptr<const Buffer<GpuVertex>>                m_VertexBuffer;
+    std::vector<ShadowCubeSlot>                             m_ShadowCubeSlots;
+    std::vector<bool>                                       m_ShadowCubeSlotsUsed;
+    std::vector<std::tuple<GLuint, GLuint>>                 m_ShadowCubeUpdates;
+    std::unique_ptr<const ShaderProgram>                    m_ShadowCullingShaderProgram;
+    std::unique_ptr<const Buffer<std::uint32_t>>            m_ShadowDrawCountBuffer;
+    std::unique_ptr<const DrawIndirectBuffer>               m_ShadowDrawIndirectBuffer;
+    std::unique_ptr<RingBuffer<GpuShadowView>>              m_ShadowViewBuffer;
+    std::unique_ptr<const Framebuffer>                      m_UpscaleFramebuffer;
+    std::unique_ptr<const ShaderProgram>                    m_UpscaleShaderProgram;
+    std::unique_ptr<const Texture2D>                        m_UpscaleTexture2D;
+    std::unique_ptr<const Texture2D>                        m_VelocityTexture2D;
 };
 
 extern std::unique_ptr<Render> g_Render;
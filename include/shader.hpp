@@ -18,6 +18,8 @@ public:
     void    SetUniform(GLuint, const glm::vec2 &) const;
     void    SetUniform(GLuint, const glm::vec3 &) const;
     void    SetUniform(GLuint, const glm::vec4 &) const;
+    void    SetUniform(GLuint, const glm::ivec2 &) const;
+    void    SetUniform(GLuint, const glm::uvec3 &) const;
     void    Use() const;
 
     GLuint  m_Handle;
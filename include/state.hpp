@@ -6,6 +6,7 @@
 extern float g_CurrentTime;
 extern float g_DeltaTime;
 extern float g_PreviousTime;
+extern std::filesystem::path g_CachePath;
 extern std::filesystem::path g_ResourcePath;
 
 #endif /* STATE_HPP */
\ No newline at end of file
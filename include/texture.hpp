@@ -12,6 +12,7 @@ public:
 
     void            Bind(GLuint) const;
     void            Bind(GLuint, const Sampler *) const;
+    void            BindImage(GLuint, GLuint, GLenum) const;
     void            GenerateMipMaps() const;
     virtual bool    Is2D() const = 0;
     virtual bool    Is2DArray() const = 0;
@@ -58,6 +59,7 @@ public:
     bool    IsCube() const override { return false; }
     bool    IsCubeArray() const override { return false; }
     GLenum  Target() const override { return GL_TEXTURE_2D_ARRAY; }
+    void    Upload(const CompressedImage *, const glm::uvec3 &) const;
     void    Upload(const Image *, const glm::uvec3 &, GLuint) const;
 };
 
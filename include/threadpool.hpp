@@ -0,0 +1,31 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    ThreadPool(unsigned int);
+    ~ThreadPool();
+
+    void                                    ParallelFor(size_t, const std::function<void(size_t)> &);
+
+private:
+    void                                    Work();
+
+    std::condition_variable                 m_Condition;
+    std::mutex                              m_Mutex;
+    bool                                    m_Quit;
+    std::deque<std::function<void()>>       m_Tasks;
+    std::vector<std::thread>                m_Threads;
+};
+
+extern std::shared_ptr<ThreadPool> g_ThreadPool;
+
+#endif /* THREADPOOL_HPP */
\ No newline at end of file
@@ -7,7 +7,17 @@ struct Vertex {
     glm::vec3       m_Position;
     glm::vec2       m_Texcoord;
     glm::vec3       m_Normal;
-    unsigned int    m_Material;
+};
+
+// Unorm16 position relative to the bounds of its mesh, w is unused
+struct VertexPosition {
+    glm::u16vec4    m_Position;
+};
+
+// Octahedral snorm16 normal and half-float texcoord
+struct VertexAttributes {
+    glm::u32        m_Normal;
+    glm::u32        m_Texcoord;
 };
 
 #endif /* VERTEX_HPP */
\ No newline at end of file
@@ -3,17 +3,23 @@
 
 #include <memory>
 
+#include <EGL/egl.h>
 #include <SDL2/SDL_video.h>
 
 class Window {
 public:
-    Window(unsigned int, unsigned int);
+    Window(unsigned int, unsigned int, bool);
     ~Window();
 
+    void            Resize(unsigned int, unsigned int);
+    void            ToggleFullscreen();
     void            Update();
 
+    EGLConfig       m_Config;
+    EGLDisplay      m_Display;
     unsigned int    m_ScreenHeight;
     unsigned int    m_ScreenWidth;
+    EGLSurface      m_Surface;
     SDL_Window *    m_Window;
 };
 
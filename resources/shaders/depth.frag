@@ -0,0 +1,16 @@
+#version 460 core
+
+in VS_OUT {
+    layout(location = 0) smooth vec4 m_ClipPos;
+    layout(location = 1) smooth vec4 m_LastClipPos;
+} VS_Output;
+
+layout(location = 0) out vec2 outVelocity;
+
+void main() {
+    const vec2 texcoord = VS_Output.m_ClipPos.xy / VS_Output.m_ClipPos.w * 0.5f;
+    const vec2 lastTexcoord = VS_Output.m_LastClipPos.xy / VS_Output.m_LastClipPos.w * 0.5f;
+
+    // Screen-space motion since the last frame, in texture coordinates
+    outVelocity = texcoord - lastTexcoord;
+}
\ No newline at end of file
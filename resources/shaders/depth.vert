@@ -1,5 +1,14 @@
 #version 460 core
 
+struct Mesh {
+    vec3  m_BoundsMax;
+    uint  m_Material;
+    vec3  m_BoundsMin;
+    uint  m_NumLods;
+    vec4  m_LodErrors;
+    uvec2 m_LodRanges[4];
+};
+
 layout(std430, binding = 0) readonly buffer CameraBuffer {
     mat4  g_LastView;
     mat4  g_Projection;
@@ -17,21 +26,39 @@ layout(std430, binding = 0) readonly buffer CameraBuffer {
     float g_FovY;
     float g_SliceBiasFactor;
     float g_SliceScalingFactor;
+    uvec2 g_RenderExtent;
+    uvec2 g_LastRenderExtent;
     float m_Padding1;
     float m_Padding2;
 };
 
-layout(std430, binding = 1) readonly buffer IndexBuffer {
-    uint g_Indices[];
+layout(std430, binding = 2) readonly buffer PositionBuffer {
+    uvec2 g_Positions[];
 };
 
-layout(std430, binding = 2) readonly buffer VertexBuffer {
-    float g_Vertices[][9];
+layout(std430, binding = 3) readonly buffer MeshBuffer {
+    Mesh g_Meshes[];
 };
 
+out VS_OUT {
+    layout(location = 0) smooth vec4 m_ClipPos;
+    layout(location = 1) smooth vec4 m_LastClipPos;
+} VS_Output;
+
+vec3 DecodePosition(uint vertex, uint mesh) {
+    const uvec2 position = g_Positions[vertex];
+    const vec3 quantized = vec3(position.x & 0xffffu, position.x >> 16u, position.y & 0xffffu) / 65535.f;
+
+    return mix(g_Meshes[mesh].m_BoundsMin, g_Meshes[mesh].m_BoundsMax, quantized);
+}
+
 void main() {
-    const uint vertex = g_Indices[gl_VertexID];
-    const vec3 fragPos = vec3(g_Vertices[vertex][0], g_Vertices[vertex][1], g_Vertices[vertex][2]);
+    const uint vertex = uint(gl_VertexID);
+    const vec3 fragPos = DecodePosition(vertex, uint(gl_BaseInstance));
+
+    // Meshes are static, so only the camera moves them between frames
+    VS_Output.m_ClipPos = g_Projection * g_View * vec4(fragPos, 1.f);
+    VS_Output.m_LastClipPos = g_Projection * g_LastView * vec4(fragPos, 1.f);
 
-    gl_Position = g_Projection * g_View * vec4(fragPos, 1.f);
+    gl_Position = VS_Output.m_ClipPos;
 }
\ No newline at end of file
@@ -19,11 +19,14 @@ layout(std430, binding = 0) readonly buffer CameraBuffer {
     float g_FovY;
     float g_SliceBiasFactor;
     float g_SliceScalingFactor;
+    uvec2 g_RenderExtent;
+    uvec2 g_LastRenderExtent;
     float m_Padding1;
     float m_Padding2;
 };
 
 layout(binding = 0) uniform sampler2D g_DepthTexture;
+layout(binding = 1) uniform sampler2D g_HiZTexture;
 layout(location = 0) uniform float g_FalloffFar;
 layout(location = 1) uniform float g_FalloffNear;
 layout(location = 2) uniform uint g_NumSamples;
@@ -31,6 +34,9 @@ layout(location = 3) uniform uint g_NumSlices;
 layout(location = 4) uniform float g_Offset;
 layout(location = 5) uniform float g_Radius;
 layout(location = 6) uniform float g_Rotation;
+layout(location = 7) uniform bool g_EnableInterleaving;
+layout(location = 8) uniform ivec2 g_InterleaveOffset;
+layout(location = 9) uniform uint g_Level;
 
 in VS_OUT {
     layout(location = 0) smooth vec2 m_Texcoord;
@@ -54,19 +60,33 @@ vec2 FastAcos(const vec2 v) {
     return vec2(FastAcos(v.x), FastAcos(v.y)); 
 }
 
+ivec2 ComputeExtent(const uint level) {
+    return max(ivec2(g_RenderExtent) >> level, ivec2(1));
+}
+
+// Horizon samples that leave the frame are clamped to its edge texels
+vec2 ComputeTexcoord(const vec2 uv, const ivec2 size, const uint level) {
+    const vec2 extent = vec2(ComputeExtent(level));
+    return clamp(uv * extent, vec2(0.5f), extent - 0.5f) / vec2(size);
+}
+
+float SampleDepth(const vec2 uv) {
+    return textureLod(g_DepthTexture, ComputeTexcoord(uv, textureSize(g_DepthTexture, 0), g_Level), 0).r;
+}
+
 vec3 ReconstructViewPos(vec3 srcPos) {
     const vec4 pos = g_ProjectionInversed * vec4(srcPos.xy * 2.f - 1.f, srcPos.z, 1);
     return pos.xyz / pos.w;
 }
 
 vec3 ReconstructNormal(vec3 srcPos, vec3 viewPos) {
-    const vec2 size = textureSize(g_DepthTexture, 0);
+    const vec2 size = ComputeExtent(g_Level);
     const vec2 up = vec2(0.f, 1.f / size.y);
     const vec2 right = vec2(1.f / size.x, 0.f);
-    const float depthUp = textureLod(g_DepthTexture, srcPos.xy + up, 0).r;
-    const float depthDown = textureLod(g_DepthTexture, srcPos.xy - up, 0).r;
-    const float depthRight = textureLod(g_DepthTexture, srcPos.xy + right, 0).r;
-    const float depthLeft = textureLod(g_DepthTexture, srcPos.xy - right, 0).r;
+    const float depthUp = SampleDepth(srcPos.xy + up);
+    const float depthDown = SampleDepth(srcPos.xy - up);
+    const float depthRight = SampleDepth(srcPos.xy + right);
+    const float depthLeft = SampleDepth(srcPos.xy - right);
     const bool isUpCloser = abs(depthUp - srcPos.z) < abs(depthDown - srcPos.z);
     const bool isRightCloser = abs(depthRight - srcPos.z) < abs(depthLeft - srcPos.z);
 
@@ -91,15 +111,16 @@ vec3 ReconstructNormal(vec3 srcPos, vec3 viewPos) {
 }
 
 void main() {
-    const vec2 texcoord = VS_Output.m_Texcoord;
-    const float depth = textureLod(g_DepthTexture, texcoord, 0).r;
+    // Interleaved tracing shades one pixel of every 2x2 block per frame
+    const ivec2 pixel = g_EnableInterleaving ? ivec2(gl_FragCoord.xy) * 2 + g_InterleaveOffset : ivec2(gl_FragCoord.xy);
+    const vec2 texcoord = (vec2(pixel) + 0.5f) / vec2(ComputeExtent(g_Level));
+    const float depth = SampleDepth(texcoord);
     const vec3 viewPos = ReconstructViewPos(vec3(texcoord, depth));
     const vec3 viewDir = normalize(-viewPos);
 
     const vec3 normal = ReconstructNormal(vec3(texcoord, depth), viewPos);
     const float radius = g_Radius * 1.f / abs(viewPos.z);
-    const ivec2 size = ivec2(gl_FragCoord);
-    const float rotationNoise = 1.f / 16.f * ((((size.x + size.y) & 3) << 2) + (size.x & 3));
+    const float rotationNoise = 1.f / 16.f * ((((pixel.x + pixel.y) & 3) << 2) + (pixel.x & 3));
 
     float totalAo = 0.f;
 
@@ -116,7 +137,7 @@ void main() {
             vec2 offset = aoDir.xy * currentSampleSize;
 
             for (uint k = 0; k < 2; k++) {
-                const float depth = textureLod(g_DepthTexture, texcoord + offset, 1).r;
+                const float depth = textureLod(g_HiZTexture, ComputeTexcoord(texcoord + offset, textureSize(g_HiZTexture, 0), max(g_Level, 1)), 0).r;
                 const vec3 sampleViewPos = ReconstructViewPos(vec3(texcoord + offset, depth));
                 const vec3 dir = sampleViewPos - viewPos;
                 const float dist2 = dot(dir, dir);
@@ -17,6 +17,8 @@ layout(std430, binding = 0) readonly buffer CameraBuffer {
     float g_FovY;
     float g_SliceBiasFactor;
     float g_SliceScalingFactor;
+    uvec2 g_RenderExtent;
+    uvec2 g_LastRenderExtent;
     float m_Padding1;
     float m_Padding2;
 };
@@ -24,6 +26,9 @@ layout(std430, binding = 0) readonly buffer CameraBuffer {
 layout(binding = 0) uniform sampler2D g_AmbientOcclusionTexture;
 layout(binding = 1) uniform sampler2D g_DepthTexture;
 layout(location = 0) uniform bool g_EnableReverseZ;
+layout(location = 1) uniform bool g_EnableInterleaving;
+layout(location = 2) uniform ivec2 g_InterleaveOffset;
+layout(location = 3) uniform uint g_Level;
 
 in VS_OUT {
     layout(location = 0) smooth vec2 m_Texcoord;
@@ -35,10 +40,64 @@ float LinearizeZ(const float depth, const float near, const float far) {
     return near * far / (depth * (near - far) + far);
 }
 
+float LinearizeDepth(const float depth) {
+    return g_EnableReverseZ ? LinearizeZ(depth, g_FarZ, g_NearZ) : LinearizeZ(depth, g_NearZ, g_FarZ);
+}
+
+// Interleaved tracing fills level g_Level + 1, the reconstruction writes g_Level
+ivec2 ComputeExtent(const uint level) {
+    return max(ivec2(g_RenderExtent) >> level, ivec2(1));
+}
+
+// Interleaved samples cover one pixel per 2x2 block, the rest is filled from nearby samples of similar depth
+float ReconstructInterleaved() {
+    const ivec2 pixel = ivec2(gl_FragCoord.xy);
+    const ivec2 size = ComputeExtent(g_Level + 1);
+    const ivec2 depthSize = ComputeExtent(g_Level);
+    const ivec2 center = (pixel - g_InterleaveOffset) >> 1;
+    const float depth = LinearizeDepth(texelFetch(g_DepthTexture, pixel, 0).r);
+    const float threshold = abs(0.1f * depth);
+
+    float totalAo = 0.f;
+    float totalWeight = 0.f;
+    float nearestAo = 1.f;
+    float nearestDiff = 1e30f;
+
+    for (int i = -1; i <= 1; i++) {
+        for (int j = -1; j <= 1; j++) {
+            const ivec2 sampleTexel = clamp(center + ivec2(j, i), ivec2(0), size - 1);
+            const ivec2 samplePixel = min(sampleTexel * 2 + g_InterleaveOffset, depthSize - 1);
+            const float ao = texelFetch(g_AmbientOcclusionTexture, sampleTexel, 0).r;
+            const float diff = abs(LinearizeDepth(texelFetch(g_DepthTexture, samplePixel, 0).r) - depth);
+
+            if (diff < threshold) {
+                const float weight = 1.f - clamp(10.f * diff / threshold, 0.f, 1.f);
+
+                totalAo += ao * weight;
+                totalWeight += weight;
+            }
+
+            if (diff < nearestDiff) {
+                nearestAo = ao;
+                nearestDiff = diff;
+            }
+        }
+    }
+
+    return totalWeight > 0.f ? totalAo / totalWeight : nearestAo;
+}
+
 void main() {
+    if (g_EnableInterleaving) {
+        outColor = ReconstructInterleaved();
+        return;
+    }
+
+    // Keep the 4x4 footprint inside the rendered extent
     const vec2 size = textureSize(g_AmbientOcclusionTexture, 0);
-    const vec2 offset = 1.f / size * 2.f;
-    const vec2 texcoord = VS_Output.m_Texcoord - offset;
+    const vec2 extent = vec2(ComputeExtent(g_Level));
+    const vec2 pixel = clamp(gl_FragCoord.xy, vec2(2.5f), max(extent - 2.5f, vec2(2.5f)));
+    const vec2 texcoord = (pixel - 2.f) / size;
 
     vec4 ao4x4[4];
     vec4 depth4x4[4];
@@ -52,7 +111,7 @@ void main() {
     depth4x4[2] = textureGatherOffset(g_DepthTexture, texcoord, ivec2(3, 0));
     depth4x4[3] = textureGatherOffset(g_DepthTexture, texcoord, ivec2(3, 3));
     
-    const float depth = g_EnableReverseZ ? LinearizeZ(depth4x4[0].x, g_FarZ, g_NearZ) : LinearizeZ(depth4x4[0].x, g_NearZ, g_FarZ);
+    const float depth = LinearizeDepth(depth4x4[0].x);
     const float threshold = abs(0.1f * depth);
 
     float totalAo = 0.f;
@@ -60,7 +119,7 @@ void main() {
 
     for (int i = 0; i < 4; i++) {
         for (int j = 0; j < 4; j++) {
-            const float diff = abs((g_EnableReverseZ ? LinearizeZ(depth4x4[i][j], g_FarZ, g_NearZ) : LinearizeZ(depth4x4[i][j], g_NearZ, g_FarZ)) - depth);
+            const float diff = abs(LinearizeDepth(depth4x4[i][j]) - depth);
 
             if (diff < threshold) {
                 const float weight = 1.f - clamp(10.f * diff / threshold, 0.f, 1.f);
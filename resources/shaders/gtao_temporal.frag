@@ -17,6 +17,8 @@ layout(std430, binding = 0) readonly buffer CameraBuffer {
     float g_FovY;
     float g_SliceBiasFactor;
     float g_SliceScalingFactor;
+    uvec2 g_RenderExtent;
+    uvec2 g_LastRenderExtent;
     float m_Padding1;
     float m_Padding2;
 };
@@ -25,6 +27,10 @@ layout(binding = 0) uniform sampler2D g_AmbientOcclusionSpartialTexture;
 layout(binding = 1) uniform sampler2D g_DepthTexture;
 layout(binding = 2) uniform sampler2D g_LastAmbientOcclusionTemporalTexture;
 layout(binding = 3) uniform sampler2D g_LastDepthTexture;
+layout(binding = 4) uniform sampler2D g_VelocityTexture;
+layout(location = 0) uniform bool g_EnableInterleaving;
+layout(location = 1) uniform uint g_Level;
+layout(location = 2) uniform bool g_EnableHistory;
 
 in VS_OUT {
     layout(location = 0) smooth vec2 m_Texcoord;
@@ -32,26 +38,73 @@ in VS_OUT {
 
 layout(location = 0) out float outColor;
 
+// History was rendered at last frame's extent, so the extent is passed in per texture
+vec2 ComputeTexcoord(const vec2 uv, const ivec2 size, const uvec2 renderExtent, const uint level) {
+    const vec2 extent = vec2(max(ivec2(renderExtent) >> level, ivec2(1)));
+    return clamp(uv * extent, vec2(0.5f), extent - 0.5f) / vec2(size);
+}
+
+float SampleCurrentAo(const vec2 uv) {
+    return textureLod(g_AmbientOcclusionSpartialTexture, ComputeTexcoord(uv, textureSize(g_AmbientOcclusionSpartialTexture, 0), g_RenderExtent, g_Level), 0).r;
+}
+
 vec3 ReconstructViewPos(vec3 srcPos) {
     const vec4 pos = g_ProjectionInversed * vec4(srcPos.xy * 2.f - 1.f, srcPos.z, 1.f);
     return pos.xyz / pos.w;
 }
 
 void main() {
-    const float currentDepth = texture(g_DepthTexture, VS_Output.m_Texcoord).r;
-    const vec3 currentViewPos = ReconstructViewPos(vec3(VS_Output.m_Texcoord, currentDepth));
-    const vec4 currentPos = inverse(g_View) * vec4(currentViewPos, 1.f);
-
-    const vec4 lastScrPos4 = g_Projection * g_LastView * currentPos;
-    const vec3 lastScrPos = lastScrPos4.xyz / lastScrPos4.w;
-    const vec2 lastTexcoord = lastScrPos.xy * 0.5f + vec2(0.5f);
-    const float lastDepth = texture(g_LastDepthTexture, lastTexcoord).r;
+    const vec2 extent = vec2(max(ivec2(g_RenderExtent) >> g_Level, ivec2(1)));
+    const vec2 texcoord = gl_FragCoord.xy / extent;
+    const uint depthLevel = max(g_Level, 1);
+
+    const float currentDepth = textureLod(g_DepthTexture, ComputeTexcoord(texcoord, textureSize(g_DepthTexture, 0), g_RenderExtent, depthLevel), 0).r;
+    const vec3 currentViewPos = ReconstructViewPos(vec3(texcoord, currentDepth));
+
+    // Depth pass leaves the motion of every pixel, so reprojection needs no matrix inverse
+    const vec2 velocity = textureLod(g_VelocityTexture, ComputeTexcoord(texcoord, textureSize(g_VelocityTexture, 0), g_RenderExtent, 0), 0).rg;
+    const vec2 lastTexcoord = texcoord - velocity;
+    const float lastDepth = textureLod(g_LastDepthTexture, ComputeTexcoord(lastTexcoord, textureSize(g_LastDepthTexture, 0), g_LastRenderExtent, depthLevel), 0).r;
     const vec3 lastViewPos = ReconstructViewPos(vec3(lastTexcoord, lastDepth));
 
-    float totalAo = 0.f;
+    const float currentAo = SampleCurrentAo(texcoord);
+
+    // Freshly allocated targets hold no history yet
+    if (!g_EnableHistory) {
+        outColor = currentAo;
+        return;
+    }
+
+    const float lastAo = textureLod(g_LastAmbientOcclusionTemporalTexture, ComputeTexcoord(lastTexcoord, textureSize(g_LastAmbientOcclusionTemporalTexture, 0), g_LastRenderExtent, g_Level), 0).r;
+
+    // View depth barely moves between frames unless the history belongs to another surface
+    const float disocclusion = clamp(10.f * abs(currentViewPos.z - lastViewPos.z) / abs(currentViewPos.z), 0.f, 1.f);
+
+    if (!g_EnableInterleaving) {
+        outColor = mix(lastAo, currentAo, disocclusion);
+        return;
+    }
+
+    // Interleaved frames each trace a different quarter, so history keeps accumulating and is only
+    // trusted within the variance of the current neighbourhood
+    float moment1 = 0.f;
+    float moment2 = 0.f;
+
+    for (int i = -1; i <= 1; i++) {
+        for (int j = -1; j <= 1; j++) {
+            const float ao = SampleCurrentAo(texcoord + vec2(j, i) / extent);
+
+            moment1 += ao;
+            moment2 += ao * ao;
+        }
+    }
+
+    moment1 /= 9.f;
+    moment2 /= 9.f;
 
-    const float currentAo = texture(g_AmbientOcclusionSpartialTexture, VS_Output.m_Texcoord).r;
-    const float lastAo = texture(g_LastAmbientOcclusionTemporalTexture, lastTexcoord).r;
+    const float sigma = sqrt(max(moment2 - moment1 * moment1, 0.f));
+    const float clampedLastAo = clamp(lastAo, moment1 - sigma, moment1 + sigma);
+    const bool isOutside = lastTexcoord != clamp(lastTexcoord, vec2(0.f), vec2(1.f));
 
-    outColor = mix(lastAo, currentAo, clamp(distance(currentViewPos, lastViewPos), 0.f, 1.f));
+    outColor = isOutside ? currentAo : mix(clampedLastAo, currentAo, max(disocclusion, 0.25f));
 }
\ No newline at end of file
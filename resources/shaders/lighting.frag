@@ -1,9 +1,5 @@
 #version 460 core
 
-#define GRID_SIZE_X 16
-#define GRID_SIZE_Y 8
-#define GRID_SIZE_Z 24
-
 struct LightEnvironment {
     mat4  m_CascadeViewProjections[5];
     vec4  m_CascadePlaneDistances;
@@ -30,6 +26,10 @@ struct LightPoint {
     int   m_ShadowIndex;
 };
 
+struct ShadowCube {
+    vec4 m_AtlasRects[6];
+};
+
 struct Material {
     uint m_DiffuseMap;
     uint m_MetalnessMap;
@@ -54,6 +54,8 @@ layout(std430, binding = 0) readonly buffer CameraBuffer {
     float g_FovY;
     float g_SliceBiasFactor;
     float g_SliceScalingFactor;
+    uvec2 g_RenderExtent;
+    uvec2 g_LastRenderExtent;
     float m_Padding1;
     float m_Padding2;
 };
@@ -78,6 +80,10 @@ layout(std430, binding = 6) readonly buffer MaterialBuffer {
     Material g_Materials[];
 };
 
+layout(std430, binding = 8) readonly buffer ShadowCubeBuffer {
+    ShadowCube g_ShadowCubes[];
+};
+
 layout(binding = 0) uniform sampler2D g_AmbientOcclusionTexture;
 layout(binding = 1) uniform sampler2DArray g_DiffuseTextures;
 layout(binding = 2) uniform sampler2DArray g_MetalnessTextures;
@@ -85,8 +91,9 @@ layout(binding = 3) uniform sampler2DArray g_NormalTextures;
 layout(binding = 4) uniform sampler2DArray g_RoughnessTextures;
 layout(binding = 5) uniform sampler2DArray g_ShadowCsmColorTextures;
 layout(binding = 6) uniform sampler2DArray g_ShadowCsmDepthTextures;
-layout(binding = 7) uniform samplerCubeArray g_ShadowCubeColorTextures;
-layout(binding = 8) uniform samplerCubeArray g_ShadowCubeDepthTextures;
+layout(binding = 7) uniform sampler2D g_ShadowCubeColorTexture;
+layout(binding = 8) uniform sampler2D g_ShadowCubeDepthTexture;
+layout(binding = 9) uniform sampler2D g_AmbientOcclusionDepthTexture;
 
 layout(location = 0) uniform bool g_EnableAmbientOcclusion;
 layout(location = 1) uniform bool g_EnableReverseZ;
@@ -95,6 +102,8 @@ layout(location = 3) uniform float g_ShadowCsmFilterRadius;
 layout(location = 4) uniform float g_ShadowCsmVarianceMax;
 layout(location = 5) uniform float g_ShadowCubeFilterRadius;
 layout(location = 6) uniform float g_ShadowCubeVarianceMax;
+layout(location = 7) uniform uvec3 g_GridSize;
+layout(location = 8) uniform uint g_AmbientOcclusionLevel;
 
 in VS_OUT {
     layout(location = 0) smooth vec3 m_FragPos;
@@ -195,35 +204,36 @@ float ComputeShadowCsm(const vec3 fragPos, const vec3 normal, const vec3 lightDi
     return shadow;
 }
 
-float ComputeShadowCube(const vec3 lightDir, const float lightZ, const uint layer) {
-    vec3 up;
+float ComputeShadowCube(const vec3 fragPos, const vec3 lightDir, const float lightZ, const uint lightIndex, const uint shadowIndex) {
+    // Faces follow the light's view projections, +X, -X, +Y, -Y, +Z, -Z
+    const vec3 absLightDir = abs(lightDir);
+    uint face;
 
-    if ((abs(lightDir.x) < 0.0001f) && (abs(lightDir.z) < 0.0001f)) {
-        up = (lightDir.y > 0.f) ? vec3(0.f, 0.f, -1.f) : vec3(0.f, 0.f, 1.f);
+    if (absLightDir.x >= absLightDir.y && absLightDir.x >= absLightDir.z) {
+        face = lightDir.x > 0.f ? 0 : 1;
+    } else if (absLightDir.y >= absLightDir.z) {
+        face = lightDir.y > 0.f ? 2 : 3;
     } else {
-        up = vec3(0.f, 1.f, 0.f);
+        face = lightDir.z > 0.f ? 4 : 5;
     }
 
-    const vec3 right = normalize(cross(up, lightDir));
-
-    up = normalize(cross(lightDir, right));
-
-    const mat3 rotation = mat3(right, up, -lightDir);
+    const vec4 atlasRect = g_ShadowCubes[shadowIndex].m_AtlasRects[face];
+    const vec4 clipPos = g_LightPoints[lightIndex].m_ViewProjections[face] * vec4(fragPos, 1.f);
+    const vec2 texcoord = clipPos.xy / clipPos.w * 0.5f + 0.5f;
+    const vec2 texelSize = 1.f / (atlasRect.zw * vec2(textureSize(g_ShadowCubeDepthTexture, 0)));
 
     float shadow = 0.f;
 
     for (uint i = 0; i < 16; i++) {
         const vec2 poisson = SHADOW_POISSON[i];
 
-        vec4 texcoord;
-
-        texcoord.xy = poisson * g_ShadowCubeFilterRadius;
-        texcoord.z = -sqrt(1.f - dot(texcoord.xy, texcoord.xy));
-        texcoord.w = float(layer);
-        texcoord.xyz = rotation * texcoord.xyz;
+        // Keep taps inside the face's tile so neighbouring tiles don't bleed in
+        vec2 faceTexcoord = texcoord + poisson * g_ShadowCubeFilterRadius * texelSize;
+        faceTexcoord = clamp(faceTexcoord, texelSize * 0.5f, 1.f - texelSize * 0.5f);
 
-        const float momentX = texture(g_ShadowCubeDepthTextures, texcoord).r;
-        const float momentY = texture(g_ShadowCubeColorTextures, texcoord).r;
+        const vec2 atlasTexcoord = atlasRect.xy + faceTexcoord * atlasRect.zw;
+        const float momentX = textureLod(g_ShadowCubeDepthTexture, atlasTexcoord, 0).r;
+        const float momentY = textureLod(g_ShadowCubeColorTexture, atlasTexcoord, 0).r;
         const float variance = max(momentY - (momentX * momentX), g_ShadowCubeVarianceMax);
         const float penumbra = step(lightZ, momentX);
         const float distX = lightZ - momentX;
@@ -310,6 +320,40 @@ float LinearizeZ(const float depth, const float near, const float far) {
     return near * far / (depth * (near - far) + far);
 }
 
+float LinearizeDepth(const float depth) {
+    return g_EnableReverseZ ? LinearizeZ(depth, g_FarZ, g_NearZ) : LinearizeZ(depth, g_NearZ, g_FarZ);
+}
+
+// Joint bilateral upsample, the bilinear taps are weighted down when their depth differs from the fragment
+float SampleAmbientOcclusion() {
+    if (g_AmbientOcclusionLevel == 0) {
+        return texelFetch(g_AmbientOcclusionTexture, ivec2(gl_FragCoord.xy), 0).r;
+    }
+
+    // Only the rendered extent of the reduced targets holds data
+    const ivec2 size = max(ivec2(g_RenderExtent) >> g_AmbientOcclusionLevel, ivec2(1));
+    const vec2 position = gl_FragCoord.xy / float(1 << g_AmbientOcclusionLevel) - 0.5f;
+    const ivec2 texel = ivec2(floor(position));
+    const vec2 fraction = position - vec2(texel);
+    const float depth = LinearizeDepth(gl_FragCoord.z);
+
+    float totalAo = 0.f;
+    float totalWeight = 0.f;
+
+    for (int i = 0; i < 4; i++) {
+        const ivec2 offset = ivec2(i & 1, i >> 1);
+        const ivec2 sampleTexel = clamp(texel + offset, ivec2(0), size - 1);
+        const vec2 bilinear = mix(1.f - fraction, fraction, vec2(offset));
+        const float sampleDepth = LinearizeDepth(texelFetch(g_AmbientOcclusionDepthTexture, sampleTexel, 0).r);
+        const float weight = bilinear.x * bilinear.y / (0.01f + abs(sampleDepth - depth) / depth);
+
+        totalAo += texelFetch(g_AmbientOcclusionTexture, sampleTexel, 0).r * weight;
+        totalWeight += weight;
+    }
+
+    return totalAo / max(totalWeight, 1e-5f);
+}
+
 vec3 ComputeLighting(
     const vec3 fragPos, 
     const vec2 texcoord, 
@@ -329,10 +373,11 @@ vec3 ComputeLighting(
     lighting += globalLighting * ComputeShadowCsm(fragPos, normal, globalLightDir);
 
     // Add local lights
-    const float z = g_EnableReverseZ ? LinearizeZ(gl_FragCoord.z, g_FarZ, g_NearZ) : LinearizeZ(gl_FragCoord.z, g_NearZ, g_FarZ);
+    const float z = LinearizeDepth(gl_FragCoord.z);
     const uint slice = uint(log2(z) * g_SliceScalingFactor + g_SliceBiasFactor);
     const uvec3 tile3 = uvec3(uvec2(gl_FragCoord.xy * g_TileSizeInv), slice);
-    const uint tile = tile3.x + GRID_SIZE_X * tile3.y + GRID_SIZE_X * GRID_SIZE_Y * tile3.z;
+    const uvec3 tileClamped = min(tile3, g_GridSize - 1);
+    const uint tile = tileClamped.x + g_GridSize.x * tileClamped.y + g_GridSize.x * g_GridSize.y * tileClamped.z;
     const uint offset = g_LightGrids[tile].m_Offset;
 
     for (uint i = 0; i < g_LightGrids[tile].m_Count; i++) {
@@ -354,7 +399,7 @@ vec3 ComputeLighting(
             const int shadowIndex = g_LightPoints[lightIndex].m_ShadowIndex;
 
             if (shadowIndex != -1) {
-                localLighting *= ComputeShadowCube(-lightDir, lightDist, uint(shadowIndex));
+                localLighting *= ComputeShadowCube(fragPos, -lightDir, lightDist, lightIndex, uint(shadowIndex));
             }
 
             lighting += localLighting;
@@ -364,7 +409,7 @@ vec3 ComputeLighting(
     // Add ambient environment light
     lighting += g_LightEnvironment.m_AmbientColor * albedo;
     
-    const vec3 aoFactor = g_EnableAmbientOcclusion ? ComputeGtaoMultiBounce(texelFetch(g_AmbientOcclusionTexture, ivec2(gl_FragCoord.xy), 0).r, lighting) : vec3(1.f);
+    const vec3 aoFactor = g_EnableAmbientOcclusion ? ComputeGtaoMultiBounce(SampleAmbientOcclusion(), lighting) : vec3(1.f);
 
     return lighting * aoFactor;
 }
@@ -384,7 +429,10 @@ void main() {
 
     const vec3 fragPos = VS_Output.m_FragPos;
     const vec3 viewPos = g_CameraPos - fragPos;
-    const vec3 normal = normalize(ComputeTBN(VS_Output.m_Normal, -viewPos, texcoord) * (normalColor.rgb * 2.f - 1.f));
+    // Normal maps only store x and y
+    const vec2 normalXY = normalColor.rg * 2.f - 1.f;
+    const vec3 normalTangent = vec3(normalXY, sqrt(max(1.f - dot(normalXY, normalXY), 0.f)));
+    const vec3 normal = normalize(ComputeTBN(VS_Output.m_Normal, -viewPos, texcoord) * normalTangent);
     const vec3 viewDir = normalize(viewPos);
 
     vec3 lighting = vec3(0.f);
@@ -1,5 +1,14 @@
 #version 460 core
 
+struct Mesh {
+    vec3  m_BoundsMax;
+    uint  m_Material;
+    vec3  m_BoundsMin;
+    uint  m_NumLods;
+    vec4  m_LodErrors;
+    uvec2 m_LodRanges[4];
+};
+
 layout(std430, binding = 0) readonly buffer CameraBuffer {
     mat4  g_LastView;
     mat4  g_Projection;
@@ -17,16 +26,22 @@ layout(std430, binding = 0) readonly buffer CameraBuffer {
     float g_FovY;
     float g_SliceBiasFactor;
     float g_SliceScalingFactor;
+    uvec2 g_RenderExtent;
+    uvec2 g_LastRenderExtent;
     float m_Padding1;
     float m_Padding2;
 };
 
-layout(std430, binding = 1) readonly buffer IndexBuffer {
-    uint g_Indices[];
+layout(std430, binding = 7) readonly buffer PositionBuffer {
+    uvec2 g_Positions[];
 };
 
-layout(std430, binding = 7) readonly buffer VertexBuffer {
-    float g_Vertices[][9];
+layout(std430, binding = 9) readonly buffer AttributeBuffer {
+    uvec2 g_Attributes[];
+};
+
+layout(std430, binding = 10) readonly buffer MeshBuffer {
+    Mesh g_Meshes[];
 };
 
 out VS_OUT {
@@ -36,14 +51,32 @@ out VS_OUT {
     layout(location = 3) flat uint m_Material;
 } VS_Output;
 
+vec3 DecodePosition(uint vertex, uint mesh) {
+    const uvec2 position = g_Positions[vertex];
+    const vec3 quantized = vec3(position.x & 0xffffu, position.x >> 16u, position.y & 0xffffu) / 65535.f;
+
+    return mix(g_Meshes[mesh].m_BoundsMin, g_Meshes[mesh].m_BoundsMax, quantized);
+}
+
+vec3 DecodeOctahedron(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.f - abs(encoded.x) - abs(encoded.y));
+
+    if (normal.z < 0.f) {
+        normal.xy = (1.f - abs(normal.yx)) * vec2(normal.x >= 0.f ? 1.f : -1.f, normal.y >= 0.f ? 1.f : -1.f);
+    }
+
+    return normalize(normal);
+}
+
 void main() {
-    const uint vertex = g_Indices[gl_VertexID];
-    const vec3 fragPos = vec3(g_Vertices[vertex][0], g_Vertices[vertex][1], g_Vertices[vertex][2]);
+    const uint vertex = uint(gl_VertexID);
+    const vec3 fragPos = DecodePosition(vertex, uint(gl_BaseInstance));
+    const uvec2 attributes = g_Attributes[vertex];
 
     VS_Output.m_FragPos = fragPos.xyz; 
-    VS_Output.m_Texcoord = vec2(g_Vertices[vertex][3], g_Vertices[vertex][4]); 
-    VS_Output.m_Normal = vec3(g_Vertices[vertex][5], g_Vertices[vertex][6], g_Vertices[vertex][7]); 
-    VS_Output.m_Material = floatBitsToUint(g_Vertices[vertex][8]);
+    VS_Output.m_Texcoord = unpackHalf2x16(attributes.y); 
+    VS_Output.m_Normal = DecodeOctahedron(unpackSnorm2x16(attributes.x)); 
+    VS_Output.m_Material = g_Meshes[uint(gl_BaseInstance)].m_Material;
 
     gl_Position = g_Projection * g_View * vec4(fragPos, 1.f);
 }
\ No newline at end of file
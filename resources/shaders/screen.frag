@@ -2,6 +2,7 @@
 
 layout(binding = 0) uniform sampler2D g_ScreenTexture;
 layout(location = 0) uniform uint g_Type;
+layout(location = 1) uniform vec2 g_TexcoordScale;
 
 in VS_OUT {
     layout(location = 0) smooth vec2 m_Texcoord;
@@ -13,7 +14,7 @@ const uint AMBIENT_OCCLUSION = 1 << 0;
 const uint LIGHTING = 1 << 1;
 
 void main() {
-    const vec4 screen = texture(g_ScreenTexture, VS_Output.m_Texcoord);
+    const vec4 screen = texture(g_ScreenTexture, VS_Output.m_Texcoord * g_TexcoordScale);
 
     switch (g_Type) {
         case AMBIENT_OCCLUSION:
@@ -12,23 +12,39 @@ struct LightEnvironment {
     float m_Padding2;
 };
 
-layout(std430, binding = 0) readonly buffer IndexBuffer {
-    uint g_Indices[];
+struct Mesh {
+    vec3  m_BoundsMax;
+    uint  m_Material;
+    vec3  m_BoundsMin;
+    uint  m_NumLods;
+    vec4  m_LodErrors;
+    uvec2 m_LodRanges[4];
 };
 
 layout(std430, binding = 1) readonly buffer LightEnvironmentBuffer {
     LightEnvironment g_LightEnvironment;
 };
 
-layout(std430, binding = 2) readonly buffer VertexBuffer {
-    float g_Vertices[][9];
+layout(std430, binding = 2) readonly buffer PositionBuffer {
+    uvec2 g_Positions[];
+};
+
+layout(std430, binding = 3) readonly buffer MeshBuffer {
+    Mesh g_Meshes[];
 };
 
 layout(location = 0) uniform uint g_Cascade;
 
+vec3 DecodePosition(uint vertex, uint mesh) {
+    const uvec2 position = g_Positions[vertex];
+    const vec3 quantized = vec3(position.x & 0xffffu, position.x >> 16u, position.y & 0xffffu) / 65535.f;
+
+    return mix(g_Meshes[mesh].m_BoundsMin, g_Meshes[mesh].m_BoundsMax, quantized);
+}
+
 void main() {
-    const uint vertex = g_Indices[gl_VertexID];
-    const vec4 fragPos = vec4(g_Vertices[vertex][0], g_Vertices[vertex][1], g_Vertices[vertex][2], 1.f);
+    const uint vertex = uint(gl_VertexID);
+    const vec4 fragPos = vec4(DecodePosition(vertex, uint(gl_BaseInstance)), 1.f);
 
     gl_Layer = int(g_Cascade);
     gl_Position = g_LightEnvironment.m_CascadeViewProjections[g_Cascade] * fragPos;
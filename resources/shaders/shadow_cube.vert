@@ -1,5 +1,4 @@
 #version 460 core
-#extension GL_AMD_vertex_shader_layer : require
 
 struct LightPoint {
     mat4  m_ViewProjections[6];
@@ -9,19 +8,28 @@ struct LightPoint {
     float m_Padding0;
 };
 
-layout(std430, binding = 0) readonly buffer IndexBuffer {
-    uint g_Indices[];
+struct Mesh {
+    vec3  m_BoundsMax;
+    uint  m_Material;
+    vec3  m_BoundsMin;
+    uint  m_NumLods;
+    vec4  m_LodErrors;
+    uvec2 m_LodRanges[4];
 };
 
 layout(std430, binding = 1) readonly buffer LightPointBuffer {
     LightPoint g_LightPoints[];
 };
 
-layout(std430, binding = 2) readonly buffer VertexBuffer {
-    float g_Vertices[][9];
+layout(std430, binding = 2) readonly buffer PositionBuffer {
+    uvec2 g_Positions[];
 };
 
-layout(location = 0) uniform uint g_Layer;
+layout(std430, binding = 3) readonly buffer MeshBuffer {
+    Mesh g_Meshes[];
+};
+
+layout(location = 0) uniform uint g_Face;
 layout(location = 1) uniform uint g_LightIndex;
 
 out VS_OUT {
@@ -30,14 +38,20 @@ out VS_OUT {
     layout(location = 2) flat float m_Radius;
 } VS_Output;
 
+vec3 DecodePosition(uint vertex, uint mesh) {
+    const uvec2 position = g_Positions[vertex];
+    const vec3 quantized = vec3(position.x & 0xffffu, position.x >> 16u, position.y & 0xffffu) / 65535.f;
+
+    return mix(g_Meshes[mesh].m_BoundsMin, g_Meshes[mesh].m_BoundsMax, quantized);
+}
+
 void main() {
-    const uint vertex = g_Indices[gl_VertexID];
-    const vec4 fragPos = vec4(g_Vertices[vertex][0], g_Vertices[vertex][1], g_Vertices[vertex][2], 1.f);
+    const uint vertex = uint(gl_VertexID);
+    const vec4 fragPos = vec4(DecodePosition(vertex, uint(gl_BaseInstance)), 1.f);
 
     VS_Output.m_FragPos = fragPos.xyz;
     VS_Output.m_LightPos = g_LightPoints[g_LightIndex].m_Position;
     VS_Output.m_Radius = g_LightPoints[g_LightIndex].m_Radius;
 
-    gl_Layer = int(g_Layer);
-    gl_Position = g_LightPoints[g_LightIndex].m_ViewProjections[g_Layer] * fragPos;
+    gl_Position = g_LightPoints[g_LightIndex].m_ViewProjections[g_Face] * fragPos;
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#version 460 core
+
+layout(std430, binding = 0) readonly buffer CameraBuffer {
+    mat4  g_LastView;
+    mat4  g_Projection;
+    mat4  g_ProjectionInversed;
+    mat4  g_ProjectionNonReversed;
+    mat4  g_ProjectionNonReversedInversed;
+    mat4  g_View;
+    vec3  g_CameraPos;
+    float m_Padding0;
+    vec2  g_NormTileDim;
+    vec2  g_TileSizeInv;
+    float g_FarZ;
+    float g_NearZ;
+    float g_FovX;
+    float g_FovY;
+    float g_SliceBiasFactor;
+    float g_SliceScalingFactor;
+    uvec2 g_RenderExtent;
+    uvec2 g_LastRenderExtent;
+    float m_Padding1;
+    float m_Padding2;
+};
+
+layout(binding = 0) uniform sampler2D g_LightingTexture;
+layout(binding = 1) uniform sampler2D g_LastUpscaleTexture;
+layout(binding = 2) uniform sampler2D g_VelocityTexture;
+layout(location = 0) uniform bool g_EnableHistory;
+layout(location = 1) uniform vec2 g_Jitter;
+
+in VS_OUT {
+    layout(location = 0) smooth vec2 m_Texcoord;
+} VS_Output;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // Lighting covers only the render extent of its texture and was shaded with a jittered projection
+    const vec2 extent = vec2(g_RenderExtent);
+    const vec2 size = vec2(textureSize(g_LightingTexture, 0));
+    const vec2 position = clamp(VS_Output.m_Texcoord * extent + g_Jitter, vec2(0.5f), extent - 0.5f);
+    const vec3 current = textureLod(g_LightingTexture, position / size, 0).rgb;
+
+    if (!g_EnableHistory) {
+        outColor = vec4(current, 1.f);
+        return;
+    }
+
+    // History is only trusted within the colour range of the current neighbourhood
+    const ivec2 texel = ivec2(position);
+
+    vec3 minColor = current;
+    vec3 maxColor = current;
+
+    for (int i = -1; i <= 1; i++) {
+        for (int j = -1; j <= 1; j++) {
+            const ivec2 sampleTexel = clamp(texel + ivec2(j, i), ivec2(0), ivec2(g_RenderExtent) - 1);
+            const vec3 color = texelFetch(g_LightingTexture, sampleTexel, 0).rgb;
+
+            minColor = min(minColor, color);
+            maxColor = max(maxColor, color);
+        }
+    }
+
+    const vec2 velocity = texelFetch(g_VelocityTexture, texel, 0).rg;
+    const vec2 lastTexcoord = VS_Output.m_Texcoord - velocity;
+    const bool isOutside = lastTexcoord != clamp(lastTexcoord, vec2(0.f), vec2(1.f));
+    const vec3 last = clamp(textureLod(g_LastUpscaleTexture, lastTexcoord, 0).rgb, minColor, maxColor);
+
+    outColor = vec4(isOutside ? current : mix(last, current, 0.1f), 1.f);
+}
\ No newline at end of file
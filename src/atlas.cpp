@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "atlas.hpp"
+
+Atlas::Atlas(std::uint32_t size, std::uint32_t minSize) {
+    assert(size >= minSize && minSize > 0);
+
+    m_MinSize = minSize;
+    m_Size = size;
+    m_FreeNodes = std::vector<std::vector<glm::uvec2>>(Level(minSize) + 1);
+    m_FreeNodes[0].push_back(glm::uvec2(0));
+}
+
+Atlas::~Atlas() {
+
+}
+
+std::optional<glm::uvec2> Atlas::Allocate(std::uint32_t size) {
+    const auto level = Level(std::clamp(size, m_MinSize, m_Size));
+
+    // Find the smallest free node that fits, then split it down to the requested level
+    auto found = level + 1;
+
+    for (auto i = level + 1; i > 0; i--) {
+        if (!m_FreeNodes[i - 1].empty()) {
+            found = i - 1;
+            break;
+        }
+    }
+
+    if (found > level) {
+        return std::nullopt;
+    }
+
+    auto offset = m_FreeNodes[found].back();
+
+    m_FreeNodes[found].pop_back();
+
+    for (auto i = found; i < level; i++) {
+        const auto childSize = m_Size >> (i + 1);
+
+        m_FreeNodes[i + 1].push_back(offset + glm::uvec2(childSize, 0));
+        m_FreeNodes[i + 1].push_back(offset + glm::uvec2(0, childSize));
+        m_FreeNodes[i + 1].push_back(offset + glm::uvec2(childSize, childSize));
+    }
+
+    return offset;
+}
+
+void Atlas::Free(const glm::uvec2 &offset, std::uint32_t size) {
+    auto level = Level(std::clamp(size, m_MinSize, m_Size));
+    auto node = offset;
+
+    while (level > 0) {
+        const auto parentSize = m_Size >> (level - 1);
+        const auto parent = node - glm::uvec2(node.x % parentSize, node.y % parentSize);
+        const auto childSize = parentSize / 2;
+        const auto siblings = std::array<glm::uvec2, 3> {
+            parent + glm::uvec2(node.x == parent.x ? childSize : 0, node.y - parent.y),
+            parent + glm::uvec2(node.x - parent.x, node.y == parent.y ? childSize : 0),
+            parent + glm::uvec2(node.x == parent.x ? childSize : 0, node.y == parent.y ? childSize : 0),
+        };
+
+        auto &freeNodes = m_FreeNodes[level];
+
+        const auto isFree = [&freeNodes](const glm::uvec2 &sibling) {
+            return std::find(freeNodes.begin(), freeNodes.end(), sibling) != freeNodes.end();
+        };
+
+        if (!std::all_of(siblings.begin(), siblings.end(), isFree)) {
+            break;
+        }
+
+        for (const auto &sibling : siblings) {
+            freeNodes.erase(std::find(freeNodes.begin(), freeNodes.end(), sibling));
+        }
+
+        node = parent;
+        level--;
+    }
+
+    m_FreeNodes[level].push_back(node);
+}
+
+size_t Atlas::Level(std::uint32_t size) const {
+    auto level = 0lu;
+
+    while ((m_Size >> level) > size) {
+        level++;
+    }
+
+    return level;
+}
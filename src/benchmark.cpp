@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "benchmark.hpp"
+#include "control.hpp"
+#include "state.hpp"
+#include "window.hpp"
+
+constexpr float         CAMERA_PATH_PERIOD = 20.f;
+constexpr float         DELTA_TIME = 1.f / 60.f;
+constexpr unsigned int  NUM_WARMUP_FRAMES = 8;
+
+std::unique_ptr<Benchmark> g_Benchmark = nullptr;
+
+static void WriteStatistics(std::ofstream &file, std::vector<float> times) {
+    std::sort(std::begin(times), std::end(times));
+
+    auto accum = 0.f;
+
+    for (const auto &time : times) {
+        accum += time;
+    }
+
+    const auto avg = times.empty() ? 0.f : accum / times.size();
+    const auto min = times.empty() ? 0.f : times.front();
+    const auto p99 = times.empty() ? 0.f : times[std::min(static_cast<size_t>(times.size() * 0.99f), times.size() - 1)];
+
+    file << "{ \"min\": " << min << ", \"avg\": " << avg << ", \"p99\": " << p99 << " }";
+}
+
+Benchmark::Benchmark(const std::filesystem::path &filename, unsigned int numFrames) {
+    m_Filename = filename;
+    m_FrameBegin = std::chrono::steady_clock::now();
+    m_Frames = {};
+    m_NumFrames = numFrames;
+    m_NumUpdates = 0;
+
+    m_Frames.reserve(numFrames);
+}
+
+Benchmark::~Benchmark() {
+
+}
+
+bool Benchmark::IsFinished() const {
+    return m_Frames.size() >= m_NumFrames;
+}
+
+void Benchmark::Record() {
+    // Wait for the frame to retire, so the wall time covers the GPU work and its timestamps are ready
+    glFinish();
+
+    const auto frameEnd = std::chrono::steady_clock::now();
+
+    g_Render->m_Profiler->Resolve();
+
+    if (m_NumUpdates > NUM_WARMUP_FRAMES) {
+        m_Frames.push_back(BenchmarkFrame {
+            .m_Time = std::chrono::duration<float, std::milli>(frameEnd - m_FrameBegin).count(),
+            .m_Samples = g_Render->m_Profiler->m_LastSamples,
+        });
+    }
+}
+
+void Benchmark::Update() {
+    // Step the clock with a fixed delta, so every run flies along the same path
+    g_PreviousTime = g_CurrentTime;
+    g_CurrentTime = m_NumUpdates * DELTA_TIME;
+    g_DeltaTime = g_CurrentTime - g_PreviousTime;
+
+    const auto phase = 2.f * glm::pi<float>() * g_CurrentTime / CAMERA_PATH_PERIOD;
+
+    // Fly along the nave and back while sweeping the view across the walls and the floor
+    g_Control->m_CameraDirection = glm::vec3(0.5f * glm::sin(2.f * phase), 0.f, glm::cos(phase));
+    g_Control->m_CameraPitch = 15.f * glm::sin(3.f * phase);
+    g_Control->m_CameraYaw = 90.f + 60.f * glm::sin(phase);
+
+    m_FrameBegin = std::chrono::steady_clock::now();
+    m_NumUpdates++;
+}
+
+bool Benchmark::Write() const {
+    auto file = std::ofstream(m_Filename);
+
+    if (!file.is_open()) {
+        std::cout << "Can't write benchmark: " << m_Filename << std::endl;
+        return false;
+    }
+
+    auto frameTimes = std::vector<float>();
+    auto passNames = std::vector<const char *>();
+    auto passTimes = std::map<std::string, std::vector<float>>();
+
+    for (const auto &frame : m_Frames) {
+        frameTimes.push_back(frame.m_Time);
+
+        for (const auto &sample : frame.m_Samples) {
+            auto &times = passTimes[sample.m_Name];
+
+            if (times.empty()) {
+                passNames.push_back(sample.m_Name);
+            }
+
+            times.push_back(sample.m_Time);
+        }
+    }
+
+    file << "{\n";
+    file << "  \"width\": " << g_Window->m_ScreenWidth << ",\n";
+    file << "  \"height\": " << g_Window->m_ScreenHeight << ",\n";
+    file << "  \"frames\": " << m_Frames.size() << ",\n";
+    file << "  \"summary\": {\n";
+    file << "    \"wall\": ";
+
+    WriteStatistics(file, frameTimes);
+
+    for (const auto &passName : passNames) {
+        file << ",\n    \"" << passName << "\": ";
+
+        WriteStatistics(file, passTimes[passName]);
+    }
+
+    file << "\n  },\n";
+    file << "  \"timings\": [";
+
+    for (auto i = 0u; i < m_Frames.size(); i++) {
+        const auto &frame = m_Frames[i];
+
+        file << (i > 0 ? ",\n" : "\n") << "    { \"frame\": " << i << ", \"wall\": " << frame.m_Time << ", \"passes\": {";
+
+        for (auto j = 0u; j < frame.m_Samples.size(); j++) {
+            file << (j > 0 ? ", " : " ") << "\"" << frame.m_Samples[j].m_Name << "\": " << frame.m_Samples[j].m_Time;
+        }
+
+        file << " } }";
+    }
+
+    file << "\n  ]\n";
+    file << "}\n";
+
+    std::cout << "Write benchmark: " << m_Filename << std::endl;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,314 @@
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.hpp"
+
+constexpr char MODEL_CACHE_MAGIC[] = { 'C', 'G', 'M', 'C' };
+
+static size_t MaterialsOffset() {
+    return sizeof(ModelCacheHeader);
+}
+
+static size_t MeshesOffset(const ModelCacheHeader &header) {
+    return MaterialsOffset() + header.m_NumMaterials * sizeof(ModelCacheMaterial);
+}
+
+static size_t MeshletsOffset(const ModelCacheHeader &header) {
+    return MeshesOffset(header) + header.m_NumMeshes * sizeof(ModelCacheMesh);
+}
+
+static size_t PositionsOffset(const ModelCacheHeader &header) {
+    return MeshletsOffset(header) + header.m_NumMeshlets * sizeof(Meshlet);
+}
+
+static size_t AttributesOffset(const ModelCacheHeader &header) {
+    return PositionsOffset(header) + header.m_NumVertices * sizeof(VertexPosition);
+}
+
+static size_t IndicesOffset(const ModelCacheHeader &header) {
+    return AttributesOffset(header) + header.m_NumVertices * sizeof(VertexAttributes);
+}
+
+static size_t TotalSize(const ModelCacheHeader &header) {
+    return IndicesOffset(header) + header.m_NumIndices * sizeof(std::uint32_t);
+}
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2
+static glm::vec2 EncodeOctahedron(const glm::vec3 &normal) {
+    const auto length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+
+    if (length <= 0.f) {
+        return glm::vec2(0.f);
+    }
+
+    const auto n = normal / length;
+    const auto signs = glm::vec2(n.x >= 0.f ? 1.f : -1.f, n.y >= 0.f ? 1.f : -1.f);
+
+    if (n.z < 0.f) {
+        return (glm::vec2(1.f) - glm::abs(glm::vec2(n.y, n.x))) * signs;
+    }
+
+    return glm::vec2(n.x, n.y);
+}
+
+static glm::u16 QuantizeUnorm16(float value, float min, float max) {
+    const auto extent = max - min;
+
+    if (extent <= 0.f) {
+        return 0;
+    }
+
+    return static_cast<glm::u16>(std::round(glm::clamp((value - min) / extent, 0.f, 1.f) * 65535.f));
+}
+
+// FNV-1a, stable between runs unlike std::hash
+std::uint64_t ComputeHash(const std::string &string) {
+    auto hash = 14695981039346656037ull;
+
+    for (const auto c : string) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+ModelCache::ModelCache(const std::filesystem::path &filename, const ModelCacheHeader &source) {
+    m_Data = nullptr;
+    m_Mapping = nullptr;
+    m_Size = 0;
+
+    const auto file = open(filename.c_str(), O_RDONLY);
+
+    if (file < 0) {
+        return;
+    }
+
+    struct stat status;
+
+    if (fstat(file, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(ModelCacheHeader)) {
+        const auto mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+        if (mapping != MAP_FAILED) {
+            m_Mapping = mapping;
+            m_Size = status.st_size;
+        }
+    }
+
+    close(file);
+
+    if (!m_Mapping) {
+        return;
+    }
+
+    const auto header = static_cast<const ModelCacheHeader *>(m_Mapping);
+
+    // Stale or foreign caches are ignored and cooked again
+    if (std::memcmp(header->m_Magic, MODEL_CACHE_MAGIC, sizeof(MODEL_CACHE_MAGIC)) == 0 &&
+        header->m_Version == MODEL_CACHE_VERSION &&
+        header->m_SourceHash == source.m_SourceHash &&
+        header->m_SourceTime == source.m_SourceTime &&
+        header->m_SourceSize == source.m_SourceSize &&
+        TotalSize(*header) == m_Size) {
+        std::cout << "Load model cache: " << filename << std::endl;
+
+        m_Data = static_cast<const char *>(m_Mapping);
+    }
+}
+
+ModelCache::ModelCache(std::vector<char> &&data) {
+    m_Mapping = nullptr;
+    m_Memory = std::move(data);
+    m_Data = m_Memory.data();
+    m_Size = m_Memory.size();
+}
+
+ModelCache::~ModelCache() {
+    if (m_Mapping) {
+        munmap(m_Mapping, m_Size);
+    }
+}
+
+std::vector<char> ModelCache::Cook(const ModelCacheHeader &source, const std::vector<ModelCacheMaterial> &materials, const std::vector<Mesh> &meshes) {
+    auto header = source;
+
+    header.m_NumIndices = 0;
+    header.m_NumMaterials = materials.size();
+    header.m_NumMeshes = meshes.size();
+    header.m_NumMeshlets = 0;
+    header.m_NumVertices = 0;
+
+    for (const auto &mesh : meshes) {
+        header.m_NumIndices += mesh.m_Indices.size();
+        header.m_NumMeshlets += mesh.m_Meshlets.size();
+        header.m_NumVertices += mesh.m_Vertices.size();
+    }
+
+    auto data = std::vector<char>(TotalSize(header));
+    auto cookedMeshes = reinterpret_cast<ModelCacheMesh *>(data.data() + MeshesOffset(header));
+    auto cookedMeshlets = reinterpret_cast<Meshlet *>(data.data() + MeshletsOffset(header));
+    auto cookedPositions = reinterpret_cast<VertexPosition *>(data.data() + PositionsOffset(header));
+    auto cookedAttributes = reinterpret_cast<VertexAttributes *>(data.data() + AttributesOffset(header));
+    auto cookedIndices = reinterpret_cast<std::uint32_t *>(data.data() + IndicesOffset(header));
+    auto indexOffset = 0u;
+    auto meshletOffset = 0u;
+    auto vertexOffset = 0u;
+
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + MaterialsOffset(), materials.data(), materials.size() * sizeof(ModelCacheMaterial));
+
+    for (auto i = 0u; i < meshes.size(); i++) {
+        const auto &mesh = meshes[i];
+
+        auto boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+        auto boundsMin = glm::vec3(std::numeric_limits<float>::max());
+
+        for (const auto &vertex : mesh.m_Vertices) {
+            boundsMax = glm::max(boundsMax, vertex.m_Position);
+            boundsMin = glm::min(boundsMin, vertex.m_Position);
+        }
+
+        if (mesh.m_Vertices.empty()) {
+            boundsMax = glm::vec3(0.f);
+            boundsMin = glm::vec3(0.f);
+        }
+
+        cookedMeshes[i] = ModelCacheMesh {
+            .m_BoundsMax = boundsMax,
+            .m_BoundsMin = boundsMin,
+            .m_FirstIndex = indexOffset,
+            .m_NumIndices = static_cast<std::uint32_t>(mesh.m_Indices.size()),
+            .m_FirstVertex = vertexOffset,
+            .m_NumVertices = static_cast<std::uint32_t>(mesh.m_Vertices.size()),
+            .m_Material = mesh.m_Material,
+            .m_NumLods = static_cast<std::uint32_t>(mesh.m_Lods.size()),
+            .m_Lods = {},
+        };
+
+        for (auto j = 0u; j < mesh.m_Lods.size(); j++) {
+            cookedMeshes[i].m_Lods[j] = mesh.m_Lods[j];
+            cookedMeshes[i].m_Lods[j].m_FirstIndex += indexOffset;
+        }
+
+        for (const auto &meshlet : mesh.m_Meshlets) {
+            auto &cookedMeshlet = cookedMeshlets[meshletOffset++];
+
+            cookedMeshlet = meshlet;
+            cookedMeshlet.m_FirstIndex += indexOffset;
+            cookedMeshlet.m_Mesh = i;
+        }
+
+        for (const auto &index : mesh.m_Indices) {
+            cookedIndices[indexOffset++] = vertexOffset + index;
+        }
+
+        for (const auto &vertex : mesh.m_Vertices) {
+            cookedPositions[vertexOffset] = VertexPosition {
+                .m_Position = glm::u16vec4(
+                    QuantizeUnorm16(vertex.m_Position.x, boundsMin.x, boundsMax.x),
+                    QuantizeUnorm16(vertex.m_Position.y, boundsMin.y, boundsMax.y),
+                    QuantizeUnorm16(vertex.m_Position.z, boundsMin.z, boundsMax.z),
+                    0
+                ),
+            };
+            cookedAttributes[vertexOffset] = VertexAttributes {
+                .m_Normal = glm::packSnorm2x16(EncodeOctahedron(vertex.m_Normal)),
+                .m_Texcoord = glm::packHalf2x16(vertex.m_Texcoord),
+            };
+
+            vertexOffset++;
+        }
+    }
+
+    return data;
+}
+
+bool ModelCache::Save(const std::filesystem::path &filename, const std::vector<char> &data) {
+    auto error = std::error_code();
+    auto temporaryFilename = filename;
+
+    temporaryFilename += ".tmp";
+
+    std::filesystem::create_directories(filename.parent_path(), error);
+
+    {
+        auto file = std::ofstream(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+        if (!file.write(data.data(), data.size())) {
+            std::cout << "Can't write model cache: " << filename << std::endl;
+            return false;
+        }
+    }
+
+    // Rename last so an interrupted write never leaves a truncated cache behind
+    std::filesystem::rename(temporaryFilename, filename, error);
+
+    if (error) {
+        std::cout << "Can't write model cache: " << filename << std::endl;
+        return false;
+    }
+
+    std::cout << "Save model cache: " << filename << std::endl;
+
+    return true;
+}
+
+ModelCacheHeader ModelCache::Source(const std::filesystem::path &filename) {
+    auto error = std::error_code();
+    auto header = ModelCacheHeader {};
+
+    std::memcpy(header.m_Magic, MODEL_CACHE_MAGIC, sizeof(MODEL_CACHE_MAGIC));
+
+    header.m_Version = MODEL_CACHE_VERSION;
+    header.m_SourceHash = ComputeHash(filename.lexically_normal().string());
+
+    const auto size = std::filesystem::file_size(filename, error);
+
+    header.m_SourceSize = error ? 0 : size;
+
+    const auto time = std::filesystem::last_write_time(filename, error);
+
+    header.m_SourceTime = error ? 0 : time.time_since_epoch().count();
+
+    return header;
+}
+
+const VertexAttributes *ModelCache::Attributes() const {
+    return reinterpret_cast<const VertexAttributes *>(m_Data + AttributesOffset(*Header()));
+}
+
+const ModelCacheHeader *ModelCache::Header() const {
+    return reinterpret_cast<const ModelCacheHeader *>(m_Data);
+}
+
+const std::uint32_t *ModelCache::Indices() const {
+    return reinterpret_cast<const std::uint32_t *>(m_Data + IndicesOffset(*Header()));
+}
+
+bool ModelCache::IsValid() const {
+    return m_Data != nullptr;
+}
+
+const ModelCacheMaterial *ModelCache::Materials() const {
+    return reinterpret_cast<const ModelCacheMaterial *>(m_Data + MaterialsOffset());
+}
+
+const ModelCacheMesh *ModelCache::Meshes() const {
+    return reinterpret_cast<const ModelCacheMesh *>(m_Data + MeshesOffset(*Header()));
+}
+
+const Meshlet *ModelCache::Meshlets() const {
+    return reinterpret_cast<const Meshlet *>(m_Data + MeshletsOffset(*Header()));
+}
+
+const VertexPosition *ModelCache::Positions() const {
+    return reinterpret_cast<const VertexPosition *>(m_Data + PositionsOffset(*Header()));
+}
\ No newline at end of file
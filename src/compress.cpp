@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "compress.hpp"
+
+constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static void WriteBits(std::uint8_t *block, unsigned int &offset, std::uint32_t value, unsigned int count) {
+    for (auto i = 0u; i < count; i++, offset++) {
+        block[offset / 8] |= ((value >> i) & 1u) << (offset % 8);
+    }
+}
+
+static void CompressBC4Channel(const CompressBlock &texels, int channel, std::uint8_t *block) {
+    auto max = 0;
+    auto min = 255;
+
+    for (auto i = 0; i < 16; i++) {
+        max = std::max(max, static_cast<int>(texels[i][channel]));
+        min = std::min(min, static_cast<int>(texels[i][channel]));
+    }
+
+    // Max first selects the eight value palette
+    int palette[8] = { max, min };
+
+    for (auto i = 2; i < 8; i++) {
+        palette[i] = ((8 - i) * max + (i - 1) * min + 3) / 7;
+    }
+
+    auto indices = std::uint64_t(0);
+
+    for (auto i = 0; i < 16 && max != min; i++) {
+        auto bestError = INT32_MAX;
+        auto bestIndex = 0;
+
+        for (auto j = 0; j < 8; j++) {
+            const auto error = std::abs(palette[j] - texels[i][channel]);
+
+            if (error < bestError) {
+                bestError = error;
+                bestIndex = j;
+            }
+        }
+
+        indices |= static_cast<std::uint64_t>(bestIndex) << (3 * i);
+    }
+
+    block[0] = max;
+    block[1] = min;
+
+    for (auto i = 0; i < 6; i++) {
+        block[2 + i] = (indices >> (8 * i)) & 0xff;
+    }
+}
+
+// Quantize to 7 bits per channel plus the shared p-bit, keep whichever p-bit fits better
+static void QuantizeBC7Endpoint(const float (&endpoint)[4], int (&quantized)[4], int &pBit) {
+    auto bestError = FLT_MAX;
+
+    for (auto p = 0; p < 2; p++) {
+        auto error = 0.f;
+        int candidate[4];
+
+        for (auto c = 0; c < 4; c++) {
+            candidate[c] = std::clamp(static_cast<int>(std::lround((endpoint[c] - p) * 0.5f)), 0, 127);
+
+            const auto delta = static_cast<float>((candidate[c] << 1) | p) - endpoint[c];
+
+            error += delta * delta;
+        }
+
+        if (error < bestError) {
+            bestError = error;
+            pBit = p;
+            std::memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+static float FindBC7Indices(const float (&texels)[16][4], const int (&e0)[4], const int (&e1)[4], int (&indices)[16]) {
+    float palette[16][4];
+    auto totalError = 0.f;
+
+    for (auto i = 0; i < 16; i++) {
+        for (auto c = 0; c < 4; c++) {
+            palette[i][c] = static_cast<float>(((64 - BC7_WEIGHTS[i]) * e0[c] + BC7_WEIGHTS[i] * e1[c] + 32) >> 6);
+        }
+    }
+
+    for (auto i = 0; i < 16; i++) {
+        auto bestError = FLT_MAX;
+
+        for (auto j = 0; j < 16; j++) {
+            auto error = 0.f;
+
+            for (auto c = 0; c < 4; c++) {
+                const auto delta = palette[j][c] - texels[i][c];
+
+                error += delta * delta;
+            }
+
+            if (error < bestError) {
+                bestError = error;
+                indices[i] = j;
+            }
+        }
+
+        totalError += bestError;
+    }
+
+    return totalError;
+}
+
+static float EncodeBC7Endpoints(const float (&texels)[16][4], const float (&endpoint0)[4], const float (&endpoint1)[4], int (&q0)[4], int (&q1)[4], int &p0, int &p1, int (&indices)[16]) {
+    QuantizeBC7Endpoint(endpoint0, q0, p0);
+    QuantizeBC7Endpoint(endpoint1, q1, p1);
+
+    int e0[4];
+    int e1[4];
+
+    for (auto c = 0; c < 4; c++) {
+        e0[c] = (q0[c] << 1) | p0;
+        e1[c] = (q1[c] << 1) | p1;
+    }
+
+    return FindBC7Indices(texels, e0, e1, indices);
+}
+
+void CompressBC4(const CompressBlock &texels, std::uint8_t (&block)[8]) {
+    CompressBC4Channel(texels, 0, block);
+}
+
+void CompressBC5(const CompressBlock &texels, std::uint8_t (&block)[16]) {
+    CompressBC4Channel(texels, 0, block);
+    CompressBC4Channel(texels, 1, block + 8);
+}
+
+// Mode 6 only: one subset, RGBA 7.7.7.7 endpoints with unique p-bits and 4 bit indices
+void CompressBC7(const CompressBlock &block, std::uint8_t (&output)[16]) {
+    float texels[16][4];
+    float mean[4] = {};
+
+    for (auto i = 0; i < 16; i++) {
+        for (auto c = 0; c < 4; c++) {
+            texels[i][c] = block[i][c];
+            mean[c] += texels[i][c] / 16.f;
+        }
+    }
+
+    // Principal axis by power iteration on the covariance matrix
+    float covariance[4][4] = {};
+
+    for (auto i = 0; i < 16; i++) {
+        for (auto r = 0; r < 4; r++) {
+            for (auto c = 0; c < 4; c++) {
+                covariance[r][c] += (texels[i][r] - mean[r]) * (texels[i][c] - mean[c]);
+            }
+        }
+    }
+
+    float axis[4] = { 1.f, 1.f, 1.f, 1.f };
+
+    for (auto iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        auto length = 0.f;
+
+        for (auto r = 0; r < 4; r++) {
+            for (auto c = 0; c < 4; c++) {
+                next[r] += covariance[r][c] * axis[c];
+            }
+
+            length = std::max(length, std::abs(next[r]));
+        }
+
+        if (length < FLT_EPSILON) {
+            break;
+        }
+
+        for (auto c = 0; c < 4; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    auto axisLength = 0.f;
+
+    for (auto c = 0; c < 4; c++) {
+        axisLength += axis[c] * axis[c];
+    }
+
+    axisLength = std::sqrt(axisLength);
+
+    auto minT = 0.f;
+    auto maxT = 0.f;
+
+    for (auto i = 0; i < 16; i++) {
+        auto t = 0.f;
+
+        for (auto c = 0; c < 4; c++) {
+            t += (texels[i][c] - mean[c]) * axis[c] / axisLength;
+        }
+
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    float endpoint0[4];
+    float endpoint1[4];
+
+    for (auto c = 0; c < 4; c++) {
+        endpoint0[c] = std::clamp(mean[c] + axis[c] / axisLength * minT, 0.f, 255.f);
+        endpoint1[c] = std::clamp(mean[c] + axis[c] / axisLength * maxT, 0.f, 255.f);
+    }
+
+    int q0[4];
+    int q1[4];
+    int p0 = 0;
+    int p1 = 0;
+    int indices[16];
+
+    auto error = EncodeBC7Endpoints(texels, endpoint0, endpoint1, q0, q1, p0, p1, indices);
+
+    // One least squares refit of the endpoints against the chosen weights
+    auto aa = 0.f;
+    auto ab = 0.f;
+    auto bb = 0.f;
+    float ax[4] = {};
+    float bx[4] = {};
+
+    for (auto i = 0; i < 16; i++) {
+        const auto b = BC7_WEIGHTS[indices[i]] / 64.f;
+        const auto a = 1.f - b;
+
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+
+        for (auto c = 0; c < 4; c++) {
+            ax[c] += a * texels[i][c];
+            bx[c] += b * texels[i][c];
+        }
+    }
+
+    const auto determinant = aa * bb - ab * ab;
+
+    if (std::abs(determinant) > FLT_EPSILON) {
+        for (auto c = 0; c < 4; c++) {
+            endpoint0[c] = std::clamp((bb * ax[c] - ab * bx[c]) / determinant, 0.f, 255.f);
+            endpoint1[c] = std::clamp((aa * bx[c] - ab * ax[c]) / determinant, 0.f, 255.f);
+        }
+
+        int refinedQ0[4];
+        int refinedQ1[4];
+        int refinedP0 = 0;
+        int refinedP1 = 0;
+        int refinedIndices[16];
+
+        const auto refinedError = EncodeBC7Endpoints(texels, endpoint0, endpoint1, refinedQ0, refinedQ1, refinedP0, refinedP1, refinedIndices);
+
+        if (refinedError < error) {
+            std::memcpy(q0, refinedQ0, sizeof(q0));
+            std::memcpy(q1, refinedQ1, sizeof(q1));
+            std::memcpy(indices, refinedIndices, sizeof(indices));
+
+            p0 = refinedP0;
+            p1 = refinedP1;
+        }
+    }
+
+    // The anchor index has an implicit zero high bit, swap the endpoints if needed
+    if (indices[0] & 8) {
+        std::swap(q0, q1);
+        std::swap(p0, p1);
+
+        for (auto &index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    auto offset = 0u;
+
+    std::memset(output, 0, sizeof(output));
+
+    WriteBits(output, offset, 1u << 6, 7);
+
+    for (auto c = 0; c < 4; c++) {
+        WriteBits(output, offset, q0[c], 7);
+        WriteBits(output, offset, q1[c], 7);
+    }
+
+    WriteBits(output, offset, p0, 1);
+    WriteBits(output, offset, p1, 1);
+
+    for (auto i = 0; i < 16; i++) {
+        WriteBits(output, offset, indices[i], i == 0 ? 3 : 4);
+    }
+}
\ No newline at end of file
@@ -1,11 +1,130 @@
+#include <cstdio>
 #include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
+#include "cache.hpp"
+#include "compress.hpp"
 #include "image.hpp"
+#include "state.hpp"
+#include "threadpool.hpp"
+
+constexpr std::uint8_t  KTX2_IDENTIFIER[12] = { 0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n' };
+constexpr std::uint32_t TEXTURE_CACHE_VERSION = 1;
+
+// Vulkan format ids as used by KTX2
+constexpr std::uint32_t VK_FORMAT_BC4_UNORM_BLOCK = 139;
+constexpr std::uint32_t VK_FORMAT_BC5_UNORM_BLOCK = 141;
+constexpr std::uint32_t VK_FORMAT_BC7_UNORM_BLOCK = 145;
+
+struct Ktx2Header {
+    std::uint8_t    m_Identifier[12];
+    std::uint32_t   m_VkFormat;
+    std::uint32_t   m_TypeSize;
+    std::uint32_t   m_PixelWidth;
+    std::uint32_t   m_PixelHeight;
+    std::uint32_t   m_PixelDepth;
+    std::uint32_t   m_LayerCount;
+    std::uint32_t   m_FaceCount;
+    std::uint32_t   m_LevelCount;
+    std::uint32_t   m_SupercompressionScheme;
+    std::uint32_t   m_DfdByteOffset;
+    std::uint32_t   m_DfdByteLength;
+    std::uint32_t   m_KvdByteOffset;
+    std::uint32_t   m_KvdByteLength;
+    std::uint64_t   m_SgdByteOffset;
+    std::uint64_t   m_SgdByteLength;
+};
+
+struct Ktx2Level {
+    std::uint64_t   m_ByteOffset;
+    std::uint64_t   m_ByteLength;
+    std::uint64_t   m_UncompressedByteLength;
+};
+
+// Images are decoded from several threads at once
+static std::mutex g_LogMutex;
+
+static std::uint32_t FindVkFormat(ImageCompression compression) {
+    switch (compression) {
+        case ImageCompression::BC4:
+            return VK_FORMAT_BC4_UNORM_BLOCK;
+        case ImageCompression::BC5:
+            return VK_FORMAT_BC5_UNORM_BLOCK;
+        case ImageCompression::BC7:
+            return VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+
+    return 0;
+}
+
+static std::vector<glm::u8vec4> ExpandImage(const Image &image) {
+    auto texels = std::vector<glm::u8vec4>(image.m_Width * image.m_Height);
+    const auto data = static_cast<const std::uint8_t *>(image.m_Data);
+
+    for (auto i = 0u; i < texels.size(); i++) {
+        const auto texel = &data[i * image.m_Channels];
+
+        switch (image.m_Channels) {
+            case 1:
+                texels[i] = glm::u8vec4(texel[0], texel[0], texel[0], 255);
+                break;
+            case 2:
+                texels[i] = glm::u8vec4(texel[0], texel[0], texel[0], texel[1]);
+                break;
+            case 3:
+                texels[i] = glm::u8vec4(texel[0], texel[1], texel[2], 255);
+                break;
+            default:
+                texels[i] = glm::u8vec4(texel[0], texel[1], texel[2], texel[3]);
+                break;
+        }
+    }
+
+    return texels;
+}
+
+// 2x2 box filter, normals are renormalized after averaging
+static std::vector<glm::u8vec4> DownsampleImage(const std::vector<glm::u8vec4> &texels, const glm::uvec2 &extent, bool isNormal) {
+    const auto nextExtent = glm::max(extent / 2u, glm::uvec2(1u));
+
+    auto nextTexels = std::vector<glm::u8vec4>(nextExtent.x * nextExtent.y);
+
+    for (auto y = 0u; y < nextExtent.y; y++) {
+        for (auto x = 0u; x < nextExtent.x; x++) {
+            const auto x0 = std::min(x * 2u, extent.x - 1);
+            const auto x1 = std::min(x * 2u + 1, extent.x - 1);
+            const auto y0 = std::min(y * 2u, extent.y - 1);
+            const auto y1 = std::min(y * 2u + 1, extent.y - 1);
+
+            auto sum = glm::vec4(0.f);
+
+            for (const auto &texel : { texels[y0 * extent.x + x0], texels[y0 * extent.x + x1], texels[y1 * extent.x + x0], texels[y1 * extent.x + x1] }) {
+                sum += glm::vec4(texel);
+            }
+
+            sum /= 4.f;
+
+            if (isNormal) {
+                auto normal = glm::vec3(sum) / 127.5f - 1.f;
+
+                normal = glm::length(normal) > 0.f ? glm::normalize(normal) : glm::vec3(0.f, 0.f, 1.f);
+                sum = glm::vec4((normal + 1.f) * 127.5f, sum.w);
+            }
+
+            nextTexels[y * nextExtent.x + x] = glm::u8vec4(glm::clamp(glm::round(sum), 0.f, 255.f));
+        }
+    }
+
+    return nextTexels;
+}
 
 Image::Image(const std::filesystem::path &filename) {
     auto channels = 0;
@@ -13,6 +132,8 @@ Image::Image(const std::filesystem::path &filename) {
     auto width = 0;
     auto data = stbi_load(filename.c_str(), &width, &height, &channels, 0);
 
+    auto lock = std::unique_lock(g_LogMutex);
+
     if (data) {
         std::cout << "Load texture: " << filename << std::endl;
 
@@ -50,4 +171,221 @@ unsigned int Image::MipLevel() const {
 
 unsigned int Image::Size() const {
     return m_Width * m_Height * m_Channels;
+}
+
+CompressedImage::CompressedImage(const std::filesystem::path &filename, ImageCompression compression) {
+    m_Compression = compression;
+    m_Height = 0;
+    m_Width = 0;
+
+    // Key on everything that changes the output, stale files are simply never looked up again
+    auto error = std::error_code();
+    auto key = filename.lexically_normal().string();
+
+    key += "|" + std::to_string(static_cast<std::uint32_t>(compression));
+    key += "|" + std::to_string(std::filesystem::file_size(filename, error));
+    key += "|" + std::to_string(std::filesystem::last_write_time(filename, error).time_since_epoch().count());
+    key += "|" + std::to_string(TEXTURE_CACHE_VERSION);
+
+    char cacheName[32];
+    std::snprintf(cacheName, sizeof(cacheName), "%016llx.ktx2", static_cast<unsigned long long>(ComputeHash(key)));
+
+    const auto cacheFilename = g_CachePath / cacheName;
+
+    {
+        auto file = std::ifstream(cacheFilename, std::ios::binary);
+
+        if (file) {
+            m_Data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+    }
+
+    if (Parse()) {
+        auto lock = std::unique_lock(g_LogMutex);
+
+        std::cout << "Load compressed texture: " << filename << std::endl;
+        return;
+    }
+
+    const auto image = Image(filename);
+
+    if (!image.m_Data) {
+        m_Data.clear();
+        return;
+    }
+
+    Compress(image);
+
+    if (!Parse()) {
+        m_Data.clear();
+        return;
+    }
+
+    auto temporaryFilename = cacheFilename;
+
+    temporaryFilename += ".tmp";
+
+    std::filesystem::create_directories(g_CachePath, error);
+
+    auto saved = false;
+
+    {
+        auto file = std::ofstream(temporaryFilename, std::ios::binary | std::ios::trunc);
+
+        saved = static_cast<bool>(file.write(m_Data.data(), m_Data.size()));
+    }
+
+    if (saved) {
+        std::filesystem::rename(temporaryFilename, cacheFilename, error);
+    }
+
+    auto lock = std::unique_lock(g_LogMutex);
+
+    if (saved && !error) {
+        std::cout << "Compress texture: " << filename << std::endl;
+    } else {
+        std::cout << "Can't write compressed texture: " << cacheFilename << std::endl;
+    }
+}
+
+CompressedImage::~CompressedImage() {
+
+}
+
+void CompressedImage::Compress(const Image &image) {
+    const auto blockSize = m_Compression == ImageCompression::BC4 ? 8u : 16u;
+
+    auto extent = glm::uvec2(image.m_Width, image.m_Height);
+    auto levels = std::vector<std::vector<std::uint8_t>>();
+    auto texels = ExpandImage(image);
+
+    while (true) {
+        const auto numBlocks = (extent + 3u) / 4u;
+
+        auto blocks = std::vector<std::uint8_t>(numBlocks.x * numBlocks.y * blockSize);
+
+        g_ThreadPool->ParallelFor(numBlocks.y, [&](size_t blockY) {
+            for (auto blockX = 0u; blockX < numBlocks.x; blockX++) {
+                CompressBlock block;
+
+                // Blocks hanging over the edge repeat the last row and column
+                for (auto y = 0u; y < 4; y++) {
+                    for (auto x = 0u; x < 4; x++) {
+                        const auto texelX = std::min(blockX * 4 + x, extent.x - 1);
+                        const auto texelY = std::min(static_cast<unsigned int>(blockY) * 4 + y, extent.y - 1);
+
+                        block[y * 4 + x] = texels[texelY * extent.x + texelX];
+                    }
+                }
+
+                auto output = &blocks[(blockY * numBlocks.x + blockX) * blockSize];
+
+                switch (m_Compression) {
+                    case ImageCompression::BC4:
+                        CompressBC4(block, *reinterpret_cast<std::uint8_t (*)[8]>(output));
+                        break;
+                    case ImageCompression::BC5:
+                        CompressBC5(block, *reinterpret_cast<std::uint8_t (*)[16]>(output));
+                        break;
+                    case ImageCompression::BC7:
+                        CompressBC7(block, *reinterpret_cast<std::uint8_t (*)[16]>(output));
+                        break;
+                }
+            }
+        });
+
+        levels.push_back(std::move(blocks));
+
+        if (extent.x == 1 && extent.y == 1) {
+            break;
+        }
+
+        texels = DownsampleImage(texels, extent, m_Compression == ImageCompression::BC5);
+        extent = glm::max(extent / 2u, glm::uvec2(1u));
+    }
+
+    // Level index lists the base level first, the data itself is stored smallest level first
+    const auto align = [](size_t offset) { return (offset + 15) & ~size_t(15); };
+
+    auto header = Ktx2Header {};
+
+    std::memcpy(header.m_Identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+
+    header.m_VkFormat = FindVkFormat(m_Compression);
+    header.m_TypeSize = 1;
+    header.m_PixelWidth = image.m_Width;
+    header.m_PixelHeight = image.m_Height;
+    header.m_FaceCount = 1;
+    header.m_LevelCount = levels.size();
+
+    auto levelIndex = std::vector<Ktx2Level>(levels.size());
+    auto offset = align(sizeof(Ktx2Header) + levelIndex.size() * sizeof(Ktx2Level));
+
+    for (auto i = levels.size(); i-- > 0;) {
+        levelIndex[i] = Ktx2Level {
+            .m_ByteOffset = offset,
+            .m_ByteLength = levels[i].size(),
+            .m_UncompressedByteLength = levels[i].size(),
+        };
+
+        offset = align(offset + levels[i].size());
+    }
+
+    m_Data.assign(offset, 0);
+
+    std::memcpy(m_Data.data(), &header, sizeof(header));
+    std::memcpy(m_Data.data() + sizeof(header), levelIndex.data(), levelIndex.size() * sizeof(Ktx2Level));
+
+    for (auto i = 0u; i < levels.size(); i++) {
+        std::memcpy(m_Data.data() + levelIndex[i].m_ByteOffset, levels[i].data(), levels[i].size());
+    }
+}
+
+const void *CompressedImage::Level(unsigned int level) const {
+    return m_Data.data() + std::get<0>(m_Levels.at(level));
+}
+
+unsigned int CompressedImage::LevelSize(unsigned int level) const {
+    return std::get<1>(m_Levels.at(level));
+}
+
+unsigned int CompressedImage::MipLevel() const {
+    return m_Levels.size();
+}
+
+bool CompressedImage::Parse() {
+    m_Levels.clear();
+
+    if (m_Data.size() < sizeof(Ktx2Header)) {
+        return false;
+    }
+
+    auto header = Ktx2Header {};
+
+    std::memcpy(&header, m_Data.data(), sizeof(header));
+
+    if (std::memcmp(header.m_Identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 ||
+        header.m_VkFormat != FindVkFormat(m_Compression) ||
+        header.m_LevelCount == 0 ||
+        m_Data.size() < sizeof(Ktx2Header) + header.m_LevelCount * sizeof(Ktx2Level)) {
+        return false;
+    }
+
+    for (auto i = 0u; i < header.m_LevelCount; i++) {
+        auto level = Ktx2Level {};
+
+        std::memcpy(&level, m_Data.data() + sizeof(Ktx2Header) + i * sizeof(Ktx2Level), sizeof(level));
+
+        if (level.m_ByteOffset + level.m_ByteLength > m_Data.size()) {
+            m_Levels.clear();
+            return false;
+        }
+
+        m_Levels.push_back(std::make_tuple(level.m_ByteOffset, level.m_ByteLength));
+    }
+
+    m_Height = header.m_PixelHeight;
+    m_Width = header.m_PixelWidth;
+
+    return true;
 }
\ No newline at end of file
@@ -1,26 +1,35 @@
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 
 #include <SDL2/SDL.h>
 
+#include "benchmark.hpp"
 #include "camera.hpp"
 #include "control.hpp"
 #include "model.hpp"
 #include "render.hpp"
 #include "scene.hpp"
 #include "state.hpp"
+#include "threadpool.hpp"
 #include "ui.hpp"
 #include "window.hpp"
 
 int main(int argc, char **argv) {
+    auto benchmarkFilename = "benchmark.json";
     auto filename = "scenes/sponza.obj";
 
     auto i = 0u;
+    auto benchmarkFrames = 0u;
     auto height = 720;
     auto width = 1280;
 
     for (; i < argc; i++) {
-        if (std::strcmp(argv[i], "--model") == 0) {
+        if (std::strcmp(argv[i], "--benchmark") == 0) {
+            benchmarkFrames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--benchmark-output") == 0) {
+            benchmarkFilename = argv[++i];
+        } else if (std::strcmp(argv[i], "--model") == 0) {
             filename = argv[++i];
         } else if (std::strcmp(argv[i], "--height") == 0) {
             height = std::atoi(argv[++i]);
@@ -29,20 +38,33 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    // Benchmark runs offscreen, so it doesn't need a video subsystem
+    const auto offscreen = benchmarkFrames > 0;
+
+    if (!offscreen && SDL_Init(SDL_INIT_VIDEO) < 0) {
         std::cout << "SDL could not be initialized. " << SDL_GetError() << std::endl;
         return 0;
     }
 
-    g_Window = std::make_shared<Window>(height, width);
+    g_Window = std::make_shared<Window>(height, width, offscreen);
 
     auto aspectRatio = width / static_cast<float>(height);
 
     g_Control = std::make_shared<Control>();
+    g_ThreadPool = std::make_shared<ThreadPool>(std::max(std::thread::hardware_concurrency(), 2u) - 1);
     g_Render = std::make_unique<Render>();
     g_Scene = std::make_unique<Scene>();
     g_Ui = std::make_shared<Ui>();
 
+    if (offscreen) {
+        if (!g_Render->m_Context) {
+            std::cout << "Benchmark requires an offscreen context." << std::endl;
+            return 1;
+        }
+
+        g_Benchmark = std::make_unique<Benchmark>(benchmarkFilename, benchmarkFrames);
+    }
+
     auto clock = std::chrono::system_clock::now();
     auto events = std::vector<SDL_Event>();
     auto quit = false;
@@ -63,9 +85,13 @@ int main(int argc, char **argv) {
     g_Scene->Insert(std::move(lightEnvironment));
 
     while (!quit) {
-        g_PreviousTime = g_CurrentTime;
-        g_CurrentTime = static_cast<std::chrono::duration<float>>(std::chrono::system_clock::now() - clock).count();
-        g_DeltaTime = g_CurrentTime - g_PreviousTime;
+        if (g_Benchmark) {
+            g_Benchmark->Update();
+        } else {
+            g_PreviousTime = g_CurrentTime;
+            g_CurrentTime = static_cast<std::chrono::duration<float>>(std::chrono::system_clock::now() - clock).count();
+            g_DeltaTime = g_CurrentTime - g_PreviousTime;
+        }
 
         events.clear();
 
@@ -77,24 +103,49 @@ int main(int argc, char **argv) {
             } else if (event.type == SDL_KEYDOWN) {
                 if (event.key.keysym.sym == SDLK_ESCAPE) {
                     quit = true;
+                } else if (event.key.keysym.sym == SDLK_F11) {
+                    g_Window->ToggleFullscreen();
+                }
+            } else if (event.type == SDL_WINDOWEVENT) {
+                if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+                    g_Window->Resize(event.window.data2, event.window.data1);
                 }
             }
 
             events.push_back(event);
         }
 
-        SDL_SetRelativeMouseMode(SDL_TRUE);
+        if (!g_Benchmark) {
+            SDL_SetRelativeMouseMode(SDL_TRUE);
+        }
 
         g_Scene->Update();
-        g_Control->Update(events);
+
+        // Benchmark drives the camera itself
+        if (!g_Benchmark) {
+            g_Control->Update(events);
+        }
+
         g_Render->Update();
         g_Ui->Update(events);
-        g_Window->Update();    
+        g_Window->Update();
+
+        if (g_Benchmark) {
+            g_Benchmark->Record();
+
+            quit = quit || g_Benchmark->IsFinished();
+        }
+    }
+
+    if (g_Benchmark) {
+        g_Benchmark->Write();
     }
 
+    g_Benchmark = nullptr;
     g_Scene = nullptr;
     g_Ui = nullptr;
     g_Render = nullptr;
+    g_ThreadPool = nullptr;
     g_Window = nullptr;
     return 0;
 }
@@ -1,10 +1,653 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+
 #include "mesh.hpp"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<glm::u32> indices) {
+constexpr size_t MESH_CACHE_SIZE = 16;
+constexpr float  MESH_LOD_MIN_REDUCTION = 0.8f;
+constexpr size_t MESH_MIN_CLUSTER_SIZE = 64;
+constexpr size_t MESHLET_MAX_TRIANGLES = 124;
+constexpr size_t MESHLET_MAX_VERTICES = 64;
+
+// Sum of squared distances to a set of planes, upper triangle of a symmetric 4x4 matrix
+typedef std::array<double, 10> Quadric;
+
+static Quadric ComputePlaneQuadric(const glm::vec3 &normal, float distance) {
+    const auto a = static_cast<double>(normal.x);
+    const auto b = static_cast<double>(normal.y);
+    const auto c = static_cast<double>(normal.z);
+    const auto d = static_cast<double>(distance);
+
+    return Quadric { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+}
+
+static void AddQuadric(Quadric &dst, const Quadric &src) {
+    for (auto i = 0u; i < dst.size(); i++) {
+        dst[i] += src[i];
+    }
+}
+
+static double EvaluateQuadric(const Quadric &q, const glm::vec3 &position) {
+    const auto x = static_cast<double>(position.x);
+    const auto y = static_cast<double>(position.y);
+    const auto z = static_cast<double>(position.z);
+
+    const auto error = 
+        q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x + 
+        q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y + 
+        q[7] * z * z + 2.0 * q[8] * z + 
+        q[9];
+
+    return std::max(error, 0.0);
+}
+
+struct VertexEqual {
+    bool operator()(const Vertex &lhs, const Vertex &rhs) const {
+        return std::memcmp(&lhs, &rhs, sizeof(Vertex)) == 0;
+    }
+};
+
+struct VertexHash {
+    size_t operator()(const Vertex &vertex) const {
+        auto bytes = reinterpret_cast<const unsigned char *>(&vertex);
+        auto hash = 14695981039346656037ull;
+
+        for (auto i = 0u; i < sizeof(Vertex); i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+};
+
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<glm::u32> indices, glm::u32 material) {
     m_Indices = indices;
+    m_Lods = { MeshLod { .m_FirstIndex = 0, .m_NumIndices = static_cast<glm::u32>(indices.size()), .m_Error = 0.f } };
+    m_Material = material;
     m_Vertices = vertices;
 }
 
 Mesh::~Mesh() {
     
+}
+
+void Mesh::BuildLods() {
+    m_Lods = { MeshLod { .m_FirstIndex = 0, .m_NumIndices = static_cast<glm::u32>(m_Indices.size()), .m_Error = 0.f } };
+
+    if (m_Indices.size() % 3 != 0) {
+        return;
+    }
+
+    auto indices = m_Indices;
+    auto error = 0.f;
+
+    for (auto i = 1u; i < MESH_MAX_LODS; i++) {
+        const auto target = (m_Lods[0].m_NumIndices / 3 >> i) * 3;
+
+        auto stepError = 0.f;
+        auto simplifiedIndices = Simplify(indices, target, stepError);
+
+        // Locked borders stop the collapse early, a LOD barely smaller than its parent isn't worth a range
+        if (simplifiedIndices.empty() || simplifiedIndices.size() > indices.size() * MESH_LOD_MIN_REDUCTION) {
+            break;
+        }
+
+        // Errors are measured against the parent level, summing them keeps the estimate conservative
+        error += stepError;
+        indices = std::move(simplifiedIndices);
+
+        auto orderedIndices = indices;
+
+        OptimizeVertexCache(orderedIndices);
+
+        m_Lods.push_back(MeshLod {
+            .m_FirstIndex = static_cast<glm::u32>(m_Indices.size()),
+            .m_NumIndices = static_cast<glm::u32>(orderedIndices.size()),
+            .m_Error = error,
+        });
+
+        m_Indices.insert(m_Indices.end(), orderedIndices.begin(), orderedIndices.end());
+    }
+}
+
+// Splits each LOD greedily, so every meshlet stays a contiguous index range within its LOD
+void Mesh::BuildMeshlets() {
+    constexpr auto NO_MESHLET = ~0u;
+
+    m_Meshlets.clear();
+
+    auto owners = std::vector<glm::u32>(m_Vertices.size(), NO_MESHLET);
+
+    for (const auto &lod : m_Lods) {
+        const auto last = static_cast<size_t>(lod.m_FirstIndex) + lod.m_NumIndices;
+
+        auto first = static_cast<size_t>(lod.m_FirstIndex);
+        auto numVertices = static_cast<size_t>(0);
+
+        for (auto i = first; i + 2 < last; i += 3) {
+            auto numNewVertices = 0u;
+
+            for (auto j = 0u; j < 3; j++) {
+                numNewVertices += owners[m_Indices[i + j]] != m_Meshlets.size() ? 1 : 0;
+            }
+
+            if (numVertices + numNewVertices > MESHLET_MAX_VERTICES || (i - first) / 3 == MESHLET_MAX_TRIANGLES) {
+                m_Meshlets.push_back(ComputeMeshletBounds(first, i));
+
+                first = i;
+                numVertices = 0;
+            }
+
+            for (auto j = 0u; j < 3; j++) {
+                auto &owner = owners[m_Indices[i + j]];
+
+                if (owner != m_Meshlets.size()) {
+                    owner = m_Meshlets.size();
+                    numVertices++;
+                }
+            }
+        }
+
+        if (first < last) {
+            m_Meshlets.push_back(ComputeMeshletBounds(first, last));
+        }
+    }
+}
+
+// Cone follows the meshoptimizer convention, a cutoff of 1 never culls
+Meshlet Mesh::ComputeMeshletBounds(size_t first, size_t last) const {
+    auto boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+    auto boundsMin = glm::vec3(std::numeric_limits<float>::max());
+
+    for (auto i = first; i < last; i++) {
+        boundsMax = glm::max(boundsMax, m_Vertices[m_Indices[i]].m_Position);
+        boundsMin = glm::min(boundsMin, m_Vertices[m_Indices[i]].m_Position);
+    }
+
+    const auto center = (boundsMax + boundsMin) * 0.5f;
+
+    auto radius = 0.f;
+    auto axis = glm::vec3(0.f);
+
+    for (auto i = first; i < last; i++) {
+        radius = std::max(radius, glm::distance(center, m_Vertices[m_Indices[i]].m_Position));
+    }
+
+    for (auto i = first; i + 2 < last; i += 3) {
+        const auto &p0 = m_Vertices[m_Indices[i + 0]].m_Position;
+        const auto &p1 = m_Vertices[m_Indices[i + 1]].m_Position;
+        const auto &p2 = m_Vertices[m_Indices[i + 2]].m_Position;
+        const auto normal = glm::cross(p1 - p0, p2 - p0);
+        const auto length = glm::length(normal);
+
+        if (length > 0.f) {
+            axis += normal / length;
+        }
+    }
+
+    auto cutoff = 1.f;
+
+    if (glm::length(axis) > 0.f) {
+        axis = glm::normalize(axis);
+
+        auto minDot = 1.f;
+
+        for (auto i = first; i + 2 < last; i += 3) {
+            const auto &p0 = m_Vertices[m_Indices[i + 0]].m_Position;
+            const auto &p1 = m_Vertices[m_Indices[i + 1]].m_Position;
+            const auto &p2 = m_Vertices[m_Indices[i + 2]].m_Position;
+            const auto normal = glm::cross(p1 - p0, p2 - p0);
+            const auto length = glm::length(normal);
+
+            if (length > 0.f) {
+                minDot = std::min(minDot, glm::dot(normal / length, axis));
+            }
+        }
+
+        // Cones wider than a hemisphere can't reject anything
+        if (minDot > 0.1f) {
+            cutoff = std::sqrt(1.f - minDot * minDot);
+        }
+    }
+
+    return Meshlet {
+        .m_Center = center,
+        .m_Radius = radius,
+        .m_ConeAxis = axis,
+        .m_ConeCutoff = cutoff,
+        .m_FirstIndex = static_cast<glm::u32>(first),
+        .m_NumIndices = static_cast<glm::u32>(last - first),
+        .m_Mesh = 0,
+        .m_Padding0 = 0,
+    };
+}
+
+void Mesh::Optimize() {
+    DeduplicateVertices();
+
+    if (m_Indices.size() % 3 == 0) {
+        const auto clusters = OptimizeVertexCache(m_Indices);
+
+        OptimizeOverdraw(clusters);
+    }
+
+    OptimizeVertexFetch();
+}
+
+void Mesh::DeduplicateVertices() {
+    auto remap = std::vector<glm::u32>(m_Vertices.size());
+    auto uniqueVertices = std::unordered_map<Vertex, glm::u32, VertexHash, VertexEqual>();
+    auto vertices = std::vector<Vertex>();
+
+    uniqueVertices.reserve(m_Vertices.size());
+    vertices.reserve(m_Vertices.size());
+
+    for (auto i = 0u; i < m_Vertices.size(); i++) {
+        const auto [it, inserted] = uniqueVertices.try_emplace(m_Vertices[i], vertices.size());
+
+        if (inserted) {
+            vertices.push_back(m_Vertices[i]);
+        }
+
+        remap[i] = it->second;
+    }
+
+    for (auto &index : m_Indices) {
+        index = remap[index];
+    }
+
+    m_Vertices = std::move(vertices);
+}
+
+// Orders clusters so the ones facing away from the mesh center come first, they tend to occlude the rest
+void Mesh::OptimizeOverdraw(const std::vector<size_t> &clusters) {
+    const auto numClusters = clusters.size();
+
+    if (numClusters < 2) {
+        return;
+    }
+
+    auto centroid = glm::vec3(0.f);
+
+    for (const auto &vertex : m_Vertices) {
+        centroid += vertex.m_Position;
+    }
+
+    centroid /= static_cast<float>(std::max<size_t>(m_Vertices.size(), 1));
+
+    auto sortKeys = std::vector<float>(numClusters);
+
+    for (auto i = 0u; i < numClusters; i++) {
+        const auto first = clusters[i];
+        const auto last = i + 1 < numClusters ? clusters[i + 1] : m_Indices.size();
+
+        auto clusterCentroid = glm::vec3(0.f);
+        auto clusterNormal = glm::vec3(0.f);
+        auto clusterArea = 0.f;
+
+        for (auto j = first; j < last; j += 3) {
+            const auto &p0 = m_Vertices[m_Indices[j + 0]].m_Position;
+            const auto &p1 = m_Vertices[m_Indices[j + 1]].m_Position;
+            const auto &p2 = m_Vertices[m_Indices[j + 2]].m_Position;
+
+            // Cross product length is twice the area, the factor cancels out
+            const auto normal = glm::cross(p1 - p0, p2 - p0);
+            const auto area = glm::length(normal);
+
+            clusterCentroid += (p0 + p1 + p2) * (area / 3.f);
+            clusterNormal += normal;
+            clusterArea += area;
+        }
+
+        const auto normalLength = glm::length(clusterNormal);
+
+        if (clusterArea > 0.f && normalLength > 0.f) {
+            sortKeys[i] = glm::dot(clusterCentroid / clusterArea - centroid, clusterNormal / normalLength);
+        }
+    }
+
+    auto order = std::vector<size_t>(numClusters);
+
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) { return sortKeys[lhs] > sortKeys[rhs]; });
+
+    auto indices = std::vector<glm::u32>();
+
+    indices.reserve(m_Indices.size());
+
+    for (const auto i : order) {
+        const auto first = clusters[i];
+        const auto last = i + 1 < numClusters ? clusters[i + 1] : m_Indices.size();
+
+        indices.insert(indices.end(), m_Indices.begin() + first, m_Indices.begin() + last);
+    }
+
+    m_Indices = std::move(indices);
+}
+
+// Tipsify, Sander et al. 2007. Returns the first index of every cluster, clusters end where the fan had to restart
+std::vector<size_t> Mesh::OptimizeVertexCache(std::vector<glm::u32> &indices) const {
+    const auto numTriangles = indices.size() / 3;
+    const auto numVertices = m_Vertices.size();
+
+    auto clusters = std::vector<size_t>();
+
+    if (numTriangles == 0) {
+        return clusters;
+    }
+
+    // Triangles adjacent to each vertex, packed by vertex
+    auto adjacencyOffsets = std::vector<size_t>(numVertices + 1);
+    auto adjacency = std::vector<glm::u32>(indices.size());
+    auto liveTriangles = std::vector<glm::u32>(numVertices);
+
+    for (const auto index : indices) {
+        liveTriangles[index]++;
+    }
+
+    for (auto i = 0u; i < numVertices; i++) {
+        adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+    }
+
+    {
+        auto cursors = std::vector<size_t>(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+        for (auto i = 0u; i < indices.size(); i++) {
+            adjacency[cursors[indices[i]]++] = i / 3;
+        }
+    }
+
+    auto cacheTimes = std::vector<size_t>(numVertices);
+    auto candidates = std::vector<glm::u32>();
+    auto deadEnds = std::vector<glm::u32>();
+    auto emitted = std::vector<bool>(numTriangles);
+    auto orderedIndices = std::vector<glm::u32>();
+    auto clusterStart = static_cast<size_t>(0);
+    auto scanCursor = 0u;
+    auto time = MESH_CACHE_SIZE + 1;
+    auto fan = static_cast<std::int64_t>(indices[0]);
+
+    orderedIndices.reserve(indices.size());
+    clusters.push_back(0);
+
+    while (fan >= 0) {
+        candidates.clear();
+
+        for (auto i = adjacencyOffsets[fan]; i < adjacencyOffsets[fan + 1]; i++) {
+            const auto triangle = adjacency[i];
+
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            for (auto j = 0u; j < 3; j++) {
+                const auto vertex = indices[triangle * 3 + j];
+
+                orderedIndices.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+
+                if (time - cacheTimes[vertex] > MESH_CACHE_SIZE) {
+                    cacheTimes[vertex] = time++;
+                }
+            }
+
+            emitted[triangle] = true;
+        }
+
+        // Prefer the candidate that stays in the cache longest while its fan is emitted
+        auto bestPriority = -1ll;
+        fan = -1;
+
+        for (const auto vertex : candidates) {
+            if (liveTriangles[vertex] == 0) {
+                continue;
+            }
+
+            auto priority = 0ll;
+
+            if (time - cacheTimes[vertex] + 2 * liveTriangles[vertex] <= MESH_CACHE_SIZE) {
+                priority = time - cacheTimes[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fan = vertex;
+            }
+        }
+
+        if (fan >= 0) {
+            continue;
+        }
+
+        // Dead end, restart from a recent vertex or scan for any with live triangles
+        while (!deadEnds.empty() && fan < 0) {
+            const auto vertex = deadEnds.back();
+
+            deadEnds.pop_back();
+
+            if (liveTriangles[vertex] > 0) {
+                fan = vertex;
+            }
+        }
+
+        for (; scanCursor < numVertices && fan < 0; scanCursor++) {
+            if (liveTriangles[scanCursor] > 0) {
+                fan = scanCursor;
+            }
+        }
+
+        if (fan >= 0 && orderedIndices.size() - clusterStart >= MESH_MIN_CLUSTER_SIZE * 3) {
+            clusterStart = orderedIndices.size();
+            clusters.push_back(clusterStart);
+        }
+    }
+
+    indices = std::move(orderedIndices);
+
+    return clusters;
+}
+
+// Quadric edge collapse, Garland and Heckbert 1997. Vertices are only moved onto neighbours, so the vertex buffer is shared,
+// and vertices on open or non-manifold edges stay locked, which also keeps texture seams intact
+std::vector<glm::u32> Mesh::Simplify(const std::vector<glm::u32> &sourceIndices, size_t target, float &error) const {
+    const auto numVertices = m_Vertices.size();
+
+    auto indices = sourceIndices;
+    auto quadrics = std::vector<Quadric>(numVertices);
+    auto locked = std::vector<bool>(numVertices);
+    auto edges = std::unordered_map<std::uint64_t, glm::u32>();
+
+    for (auto i = static_cast<size_t>(0); i + 2 < indices.size(); i += 3) {
+        const auto &p0 = m_Vertices[indices[i + 0]].m_Position;
+        const auto &p1 = m_Vertices[indices[i + 1]].m_Position;
+        const auto &p2 = m_Vertices[indices[i + 2]].m_Position;
+        const auto normal = glm::cross(p1 - p0, p2 - p0);
+        const auto length = glm::length(normal);
+
+        if (length > 0.f) {
+            const auto quadric = ComputePlaneQuadric(normal / length, -glm::dot(normal / length, p0));
+
+            for (auto j = 0u; j < 3; j++) {
+                AddQuadric(quadrics[indices[i + j]], quadric);
+            }
+        }
+
+        for (auto j = 0u; j < 3; j++) {
+            const auto a = static_cast<std::uint64_t>(std::min(indices[i + j], indices[i + (j + 1) % 3]));
+            const auto b = static_cast<std::uint64_t>(std::max(indices[i + j], indices[i + (j + 1) % 3]));
+
+            edges[a << 32 | b]++;
+        }
+    }
+
+    for (const auto &[edge, count] : edges) {
+        if (count != 2) {
+            locked[edge >> 32] = true;
+            locked[edge & 0xffffffff] = true;
+        }
+    }
+
+    auto maxError = 0.0;
+    auto adjacencyOffsets = std::vector<size_t>(numVertices + 1);
+    auto adjacency = std::vector<glm::u32>();
+    auto collapses = std::vector<std::tuple<double, glm::u32, glm::u32>>();
+    auto remap = std::vector<glm::u32>(numVertices);
+    auto touched = std::vector<bool>(numVertices);
+
+    while (indices.size() > target) {
+        // Triangles around each vertex, rebuilt every pass since collapses rewrite the index list
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+
+        for (const auto index : indices) {
+            adjacencyOffsets[index + 1]++;
+        }
+
+        for (auto i = 0u; i < numVertices; i++) {
+            adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+        }
+
+        adjacency.resize(indices.size());
+
+        {
+            auto cursors = std::vector<size_t>(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+            for (auto i = 0u; i < indices.size(); i++) {
+                adjacency[cursors[indices[i]]++] = i / 3;
+            }
+        }
+
+        collapses.clear();
+
+        for (auto i = static_cast<size_t>(0); i < indices.size(); i++) {
+            const auto from = indices[i];
+            const auto to = indices[i - i % 3 + (i + 1) % 3];
+
+            if (locked[from]) {
+                continue;
+            }
+
+            auto quadric = quadrics[from];
+
+            AddQuadric(quadric, quadrics[to]);
+
+            collapses.push_back(std::make_tuple(EvaluateQuadric(quadric, m_Vertices[to].m_Position), from, to));
+        }
+
+        std::sort(collapses.begin(), collapses.end());
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+
+        // Each collapse removes about two triangles, stop once the target is reached
+        const auto numTrianglesToRemove = (indices.size() - target) / 3;
+
+        auto numTrianglesRemoved = static_cast<size_t>(0);
+
+        for (const auto &[cost, from, to] : collapses) {
+            if (numTrianglesRemoved >= numTrianglesToRemove) {
+                break;
+            }
+            if (touched[from] || touched[to]) {
+                continue;
+            }
+
+            auto isFlipped = false;
+            auto numShared = 0u;
+
+            for (auto i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1] && !isFlipped; i++) {
+                const auto triangle = adjacency[i] * 3;
+
+                glm::vec3 positions[3];
+                glm::vec3 collapsedPositions[3];
+                auto isShared = false;
+
+                for (auto j = 0u; j < 3; j++) {
+                    const auto vertex = indices[triangle + j];
+
+                    positions[j] = m_Vertices[vertex].m_Position;
+                    collapsedPositions[j] = m_Vertices[vertex == from ? to : vertex].m_Position;
+                    isShared = isShared || vertex == to;
+                }
+
+                if (isShared) {
+                    numShared++;
+                    continue;
+                }
+
+                const auto normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+                const auto collapsedNormal = glm::cross(collapsedPositions[1] - collapsedPositions[0], collapsedPositions[2] - collapsedPositions[0]);
+
+                isFlipped = glm::dot(normal, collapsedNormal) <= 0.f;
+            }
+
+            if (isFlipped) {
+                continue;
+            }
+
+            remap[from] = to;
+            maxError = std::max(maxError, cost);
+            numTrianglesRemoved += numShared;
+
+            AddQuadric(quadrics[to], quadrics[from]);
+
+            // Freeze the neighbourhood, later flip tests in this pass would see stale triangles otherwise
+            for (auto i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++) {
+                for (auto j = 0u; j < 3; j++) {
+                    touched[indices[adjacency[i] * 3 + j]] = true;
+                }
+            }
+        }
+
+        if (numTrianglesRemoved == 0) {
+            break;
+        }
+
+        auto collapsedIndices = std::vector<glm::u32>();
+
+        collapsedIndices.reserve(indices.size());
+
+        for (auto i = static_cast<size_t>(0); i + 2 < indices.size(); i += 3) {
+            const auto a = remap[indices[i + 0]];
+            const auto b = remap[indices[i + 1]];
+            const auto c = remap[indices[i + 2]];
+
+            if (a != b && b != c && c != a) {
+                collapsedIndices.insert(collapsedIndices.end(), { a, b, c });
+            }
+        }
+
+        indices = std::move(collapsedIndices);
+    }
+
+    error = static_cast<float>(std::sqrt(maxError));
+
+    return indices;
+}
+
+// Renumbers vertices in order of first use so fetches walk memory linearly
+void Mesh::OptimizeVertexFetch() {
+    constexpr auto NO_VERTEX = ~0u;
+
+    auto remap = std::vector<glm::u32>(m_Vertices.size(), NO_VERTEX);
+    auto vertices = std::vector<Vertex>();
+
+    vertices.reserve(m_Vertices.size());
+
+    for (auto &index : m_Indices) {
+        if (remap[index] == NO_VERTEX) {
+            remap[index] = vertices.size();
+            vertices.push_back(m_Vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    m_Vertices = std::move(vertices);
 }
\ No newline at end of file
@@ -1,4 +1,9 @@
+#include <array>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <unordered_map>
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
@@ -6,95 +11,190 @@
 
 #include "model.hpp"
 #include "state.hpp"
+#include "threadpool.hpp"
 
-Model::Model(const std::filesystem::path &filename) {
+constexpr size_t NO_IMAGE = -1;
+
+// Paths stay relative to the resource directory, so the cache survives moving it
+static bool CopyPath(char (&dst)[MODEL_CACHE_PATH_SIZE], const char *src) {
+    const auto size = std::strlen(src);
+
+    if (size >= MODEL_CACHE_PATH_SIZE) {
+        std::cout << "Texture path is too long: " << src << std::endl;
+        return false;
+    }
+
+    std::memcpy(dst, src, size + 1);
+
+    return true;
+}
+
+static bool Import(const std::filesystem::path &filename, std::vector<ModelCacheMaterial> &materials, std::vector<Mesh> &meshes) {
     auto aiImport = Assimp::Importer();
     auto aiScene = aiImport.ReadFile(filename.c_str(), aiProcess_FlipUVs | aiProcess_Triangulate);
 
-    if (aiScene && (aiScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) == 0)  {
-        auto materials = std::vector<Material>();
-        auto meshes = std::vector<Mesh>();
+    if (!aiScene || (aiScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) != 0) {
+        std::cout << "Assimp: " << aiImport.GetErrorString() << std::endl;
+        return false;
+    }
 
-        materials.reserve(aiScene->mNumMaterials);
-        meshes.reserve(aiScene->mNumMeshes);
+    materials.reserve(aiScene->mNumMaterials);
+    meshes.reserve(aiScene->mNumMeshes);
 
-        for (auto i = 0u; i < aiScene->mNumMaterials; i++) {
-            const auto aiMaterial = aiScene->mMaterials[i];
+    for (auto i = 0u; i < aiScene->mNumMaterials; i++) {
+        const auto aiMaterial = aiScene->mMaterials[i];
 
-            auto diffuseImage = std::shared_ptr<Image>();
-            auto metalnessImage = std::shared_ptr<Image>();
-            auto normalImage = std::shared_ptr<Image>();
-            auto roughnessImage = std::shared_ptr<Image>();
+        auto material = ModelCacheMaterial {};
 
-            for (auto j = 0u; j < std::min(aiMaterial->GetTextureCount(aiTextureType_DIFFUSE), 1u); j++) {
+        const auto copyTexture = [&](aiTextureType type, char (&dst)[MODEL_CACHE_PATH_SIZE]) {
+            if (aiMaterial->GetTextureCount(type) > 0) {
                 aiString aiFilename;
-                aiMaterial->GetTexture(aiTextureType_DIFFUSE, j, &aiFilename);
-                diffuseImage = std::make_shared<Image>(g_ResourcePath / aiFilename.C_Str());
+                aiMaterial->GetTexture(type, 0, &aiFilename);
+                return CopyPath(dst, aiFilename.C_Str());
             }
 
-            for (auto j = 0u; j < std::min(aiMaterial->GetTextureCount(aiTextureType_AMBIENT), 1u); j++) {
-                aiString aiFilename;
-                aiMaterial->GetTexture(aiTextureType_AMBIENT, j, &aiFilename);
-                metalnessImage = std::make_shared<Image>(g_ResourcePath / aiFilename.C_Str());
-            }
+            return true;
+        };
 
-            for (auto j = 0u; j < std::min(aiMaterial->GetTextureCount(aiTextureType_HEIGHT), 1u); j++) {
-                aiString aiFilename;
-                aiMaterial->GetTexture(aiTextureType_HEIGHT, j, &aiFilename);
-                normalImage = std::make_shared<Image>(g_ResourcePath / aiFilename.C_Str());
-            }
+        // A cache without one of the textures would drop it on every run, so the cook fails instead
+        if (!copyTexture(aiTextureType_DIFFUSE, material.m_DiffuseImage) ||
+            !copyTexture(aiTextureType_AMBIENT, material.m_MetalnessImage) ||
+            !copyTexture(aiTextureType_HEIGHT, material.m_NormalImage) ||
+            !copyTexture(aiTextureType_SHININESS, material.m_RoughnessImage)) {
+            return false;
+        }
 
-            for (auto j = 0u; j < std::min(aiMaterial->GetTextureCount(aiTextureType_SHININESS), 1u); j++) {
-                aiString aiFilename;
-                aiMaterial->GetTexture(aiTextureType_SHININESS, j, &aiFilename);
-                roughnessImage = std::make_shared<Image>(g_ResourcePath / aiFilename.C_Str());
+        materials.push_back(material);
+    }
+
+    for (auto i = 0u; i < aiScene->mNumMeshes; i++) {
+        const auto aiMesh = aiScene->mMeshes[i];
+
+        auto indices = std::vector<glm::u32>();
+        auto vertices = std::vector<Vertex>();
+
+        for (auto j = 0u; j < aiMesh->mNumFaces; j++) {
+            const auto aiFace = &aiMesh->mFaces[j];
+
+            for (auto k = 0u; k < aiFace->mNumIndices; k++) {
+                indices.push_back(aiFace->mIndices[k]);
             }
+        }
+
+        for (auto j = 0u; j < aiMesh->mNumVertices; j++) {
+            auto position = glm::vec3(aiMesh->mVertices[j].x, aiMesh->mVertices[j].y, aiMesh->mVertices[j].z);
+            auto texcoord = glm::vec2(aiMesh->mTextureCoords[0][j].x, aiMesh->mTextureCoords[0][j].y);
+            auto normal = glm::vec3(aiMesh->mNormals[j].x, aiMesh->mNormals[j].y, aiMesh->mNormals[j].z);
 
-            materials.push_back(Material {
-                .m_DiffuseImage = diffuseImage,
-                .m_MetalnessImage = metalnessImage,
-                .m_NormalImage = normalImage,
-                .m_RoughnessImage = roughnessImage,
+            vertices.push_back(Vertex {
+                .m_Position = position,
+                .m_Texcoord = texcoord,
+                .m_Normal = normal,
             });
         }
 
-        for (auto i = 0u; i < aiScene->mNumMeshes; i++) {
-            const auto aiMesh = aiScene->mMeshes[i];
+        meshes.push_back(Mesh(vertices, indices, aiMesh->mMaterialIndex));
+    }
 
-            auto indices = std::vector<glm::u32>();
-            auto vertices = std::vector<Vertex>();
+    aiImport.FreeScene();
 
-            for (auto j = 0u; j < aiMesh->mNumFaces; j++) {
-                const auto aiFace = &aiMesh->mFaces[j];
+    return true;
+}
 
-                for (auto k = 0u; k < aiFace->mNumIndices; k++) {
-                    indices.push_back(aiFace->mIndices[k]);
-                }
-            }
+Model::Model(const std::filesystem::path &filename) {
+    const auto source = ModelCache::Source(filename);
 
-            for (auto j = 0u; j < aiMesh->mNumVertices; j++) {
-                auto position = glm::vec3(aiMesh->mVertices[j].x, aiMesh->mVertices[j].y, aiMesh->mVertices[j].z);
-                auto texcoord = glm::vec2(aiMesh->mTextureCoords[0][j].x, aiMesh->mTextureCoords[0][j].y);
-                auto normal = glm::vec3(aiMesh->mNormals[j].x, aiMesh->mNormals[j].y, aiMesh->mNormals[j].z);
-
-                vertices.push_back(Vertex {
-                    .m_Position = position,
-                    .m_Texcoord = texcoord,
-                    .m_Normal = normal,
-                    .m_Material = aiMesh->mMaterialIndex,
-                });
-            }
+    char cacheName[32];
+    std::snprintf(cacheName, sizeof(cacheName), "%016llx.bin", static_cast<unsigned long long>(source.m_SourceHash));
+
+    const auto cacheFilename = g_CachePath / cacheName;
+
+    // Assimp only runs when the cache is missing or older than the source
+    m_Cache = std::make_unique<const ModelCache>(cacheFilename, source);
 
-            meshes.push_back(Mesh(vertices, indices));
+    if (!m_Cache->IsValid()) {
+        auto materials = std::vector<ModelCacheMaterial>();
+        auto meshes = std::vector<Mesh>();
+
+        if (!Import(filename, materials, meshes)) {
+            m_Cache = nullptr;
+            return;
         }
 
-        m_Materials = materials;
-        m_Meshes = meshes;
-    } else {
-        std::cout << "Assimp: " << aiImport.GetErrorString() << std::endl;
+        g_ThreadPool->ParallelFor(meshes.size(), [&](size_t i) {
+            meshes[i].Optimize();
+            meshes[i].BuildLods();
+            meshes[i].BuildMeshlets();
+        });
+
+        auto data = ModelCache::Cook(source, materials, meshes);
+
+        if (ModelCache::Save(cacheFilename, data)) {
+            m_Cache = std::make_unique<const ModelCache>(cacheFilename, source);
+        }
+        if (!m_Cache->IsValid()) {
+            m_Cache = std::make_unique<const ModelCache>(std::move(data));
+        }
     }
 
-    aiImport.FreeScene();
+    // Collect unique images, materials refer to them by index
+    auto sources = std::vector<std::tuple<std::filesystem::path, ImageCompression>>();
+    auto sourceIndices = std::unordered_map<std::string, size_t>();
+    auto materialImages = std::vector<std::array<size_t, 4>>();
+
+    const auto findImage = [&](const char *filename, ImageCompression compression) {
+        if (filename[0] == '\0') {
+            return NO_IMAGE;
+        }
+
+        const auto key = std::string(filename) + "|" + std::to_string(static_cast<std::uint32_t>(compression));
+        const auto [it, inserted] = sourceIndices.try_emplace(key, sources.size());
+
+        if (inserted) {
+            sources.push_back(std::make_tuple((g_ResourcePath / filename).lexically_normal(), compression));
+        }
+
+        return it->second;
+    };
+
+    for (auto i = 0u; i < m_Cache->Header()->m_NumMaterials; i++) {
+        const auto &material = m_Cache->Materials()[i];
+
+        materialImages.push_back({
+            findImage(material.m_DiffuseImage, ImageCompression::BC7),
+            findImage(material.m_MetalnessImage, ImageCompression::BC4),
+            findImage(material.m_NormalImage, ImageCompression::BC5),
+            findImage(material.m_RoughnessImage, ImageCompression::BC4),
+        });
+    }
+
+    // Load or compress each image once on all cores
+    auto compressedImages = std::vector<std::shared_ptr<CompressedImage>>(sources.size());
+
+    g_ThreadPool->ParallelFor(sources.size(), [&](size_t i) {
+        const auto &[filename, compression] = sources[i];
+
+        auto image = std::make_shared<CompressedImage>(filename, compression);
+
+        if (image->MipLevel() > 0) {
+            compressedImages[i] = std::move(image);
+        }
+    });
+
+    const auto findCompressedImage = [&](size_t index) {
+        return index != NO_IMAGE ? compressedImages[index] : std::shared_ptr<CompressedImage>();
+    };
+
+    m_Materials.reserve(materialImages.size());
+
+    for (const auto &images : materialImages) {
+        m_Materials.push_back(Material {
+            .m_DiffuseImage = findCompressedImage(images[0]),
+            .m_MetalnessImage = findCompressedImage(images[1]),
+            .m_NormalImage = findCompressedImage(images[2]),
+            .m_RoughnessImage = findCompressedImage(images[3]),
+        });
+    }
 }
 
 Model::~Model() {
@@ -102,21 +202,17 @@ Model::~Model() {
 }
 
 size_t Model::NumIndices() const {
-    auto accum = 0u;
+    return m_Cache ? m_Cache->Header()->m_NumIndices : 0;
+}
 
-    for (const auto &mesh : m_Meshes) {
-        accum += mesh.m_Indices.size();
-    }
+size_t Model::NumMeshes() const {
+    return m_Cache ? m_Cache->Header()->m_NumMeshes : 0;
+}
 
-    return accum;
+size_t Model::NumMeshlets() const {
+    return m_Cache ? m_Cache->Header()->m_NumMeshlets : 0;
 }
 
 size_t Model::NumVertices() const {
-    auto accum = 0u;
-
-    for (const auto &mesh : m_Meshes) {
-        accum += mesh.m_Vertices.size();
-    }
-
-    return accum;
+    return m_Cache ? m_Cache->Header()->m_NumVertices : 0;
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstring>
+
+#include "profiler.hpp"
+
+Profiler::Profiler() {
+    glCreateQueries(GL_TIMESTAMP, m_Queries.size(), m_Queries.data());
+
+    m_CurrentFrame = 0;
+    m_Frames = {};
+    m_LastFrame = 0;
+    m_LastSamples = {};
+    m_OpenScopes = {};
+    m_Scopes = {};
+}
+
+Profiler::~Profiler() {
+    glDeleteQueries(m_Queries.size(), m_Queries.data());
+}
+
+void Profiler::Begin(const char *name) {
+    auto &frame = m_Frames[m_CurrentFrame];
+
+    if (frame.m_NumScopes < PROFILER_MAX_SCOPES) {
+        const auto scope = frame.m_NumScopes++;
+
+        frame.m_Scopes[scope] = FindScope(name);
+
+        glQueryCounter(m_Queries[(m_CurrentFrame * PROFILER_MAX_SCOPES + scope) * 2 + 0], GL_TIMESTAMP);
+
+        m_OpenScopes.push_back(scope);
+    } else {
+        m_OpenScopes.push_back(PROFILER_MAX_SCOPES);
+    }
+}
+
+void Profiler::BeginFrame(std::uint32_t numFrame) {
+    Resolve();
+
+    m_CurrentFrame = (m_CurrentFrame + 1) % PROFILER_NUM_FRAMES;
+    m_OpenScopes.clear();
+
+    // Drop the slot if the GPU is still behind it, waiting on it would stall
+    auto &frame = m_Frames[m_CurrentFrame];
+
+    frame.m_Frame = numFrame;
+    frame.m_NumScopes = 0;
+    frame.m_Pending = false;
+
+    Begin("Frame");
+}
+
+void Profiler::End() {
+    if (m_OpenScopes.empty()) {
+        return;
+    }
+
+    const auto scope = m_OpenScopes.back();
+
+    if (scope < PROFILER_MAX_SCOPES) {
+        glQueryCounter(m_Queries[(m_CurrentFrame * PROFILER_MAX_SCOPES + scope) * 2 + 1], GL_TIMESTAMP);
+    }
+
+    m_OpenScopes.pop_back();
+}
+
+void Profiler::EndFrame() {
+    while (!m_OpenScopes.empty()) {
+        End();
+    }
+
+    m_Frames[m_CurrentFrame].m_Pending = true;
+}
+
+void Profiler::Resolve() {
+    for (auto i = 1u; i <= PROFILER_NUM_FRAMES; i++) {
+        const auto index = (m_CurrentFrame + i) % PROFILER_NUM_FRAMES;
+
+        auto &frame = m_Frames[index];
+
+        if (!frame.m_Pending) {
+            continue;
+        }
+
+        // Frame scope is closed last, once it's available every other query is too
+        auto available = GLuint(0);
+
+        glGetQueryObjectuiv(m_Queries[index * PROFILER_MAX_SCOPES * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available) {
+            break;
+        }
+
+        m_LastFrame = frame.m_Frame;
+        m_LastSamples.clear();
+
+        for (auto j = 0u; j < frame.m_NumScopes; j++) {
+            auto begin = GLuint64(0);
+            auto end = GLuint64(0);
+
+            glGetQueryObjectui64v(m_Queries[(index * PROFILER_MAX_SCOPES + j) * 2 + 0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(m_Queries[(index * PROFILER_MAX_SCOPES + j) * 2 + 1], GL_QUERY_RESULT, &end);
+
+            auto &scope = m_Scopes[frame.m_Scopes[j]];
+
+            const auto time = static_cast<float>(end - begin) * 1e-6f;
+
+            scope.m_Samples[scope.m_NumSamples % PROFILER_NUM_SAMPLES] = time;
+            scope.m_NumSamples++;
+
+            m_LastSamples.push_back(ProfilerSample {
+                .m_Name = scope.m_Name,
+                .m_Time = time,
+            });
+        }
+
+        frame.m_Pending = false;
+    }
+}
+
+std::vector<ProfilerStatistics> Profiler::Statistics() const {
+    auto statistics = std::vector<ProfilerStatistics>();
+
+    statistics.reserve(m_Scopes.size());
+
+    for (const auto &scope : m_Scopes) {
+        const auto numSamples = std::min(scope.m_NumSamples, PROFILER_NUM_SAMPLES);
+
+        if (numSamples == 0) {
+            continue;
+        }
+
+        auto samples = std::array<float, PROFILER_NUM_SAMPLES>();
+        auto accum = 0.f;
+
+        std::copy_n(std::begin(scope.m_Samples), numSamples, std::begin(samples));
+        std::sort(std::begin(samples), std::begin(samples) + numSamples);
+
+        for (auto i = 0u; i < numSamples; i++) {
+            accum += samples[i];
+        }
+
+        statistics.push_back(ProfilerStatistics {
+            .m_Name = scope.m_Name,
+            .m_Avg = accum / numSamples,
+            .m_Min = samples[0],
+            .m_P99 = samples[std::min(static_cast<size_t>(numSamples * 0.99f), numSamples - 1)],
+        });
+    }
+
+    return statistics;
+}
+
+size_t Profiler::FindScope(const char *name) {
+    for (auto i = 0u; i < m_Scopes.size(); i++) {
+        if (m_Scopes[i].m_Name == name || std::strcmp(m_Scopes[i].m_Name, name) == 0) {
+            return i;
+        }
+    }
+
+    m_Scopes.push_back(ProfilerScope {
+        .m_Name = name,
+        .m_NumSamples = 0,
+        .m_Samples = {},
+    });
+
+    return m_Scopes.size() - 1;
+}
\ No newline at end of file
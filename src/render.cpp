@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <array>
 #include <iostream>
+#include <limits>
 
 #include <glm/ext/matrix_transform.hpp>
 
@@ -10,16 +12,25 @@
 #include "state.hpp"
 #include "window.hpp"
 
+constexpr GLuint  AMBIENT_OCCLUSION_MIP_LEVEL = 4;
 constexpr GLfloat COLOR_ONE[] = { 1.f, 1.f, 1.f, 1.f };
 constexpr GLfloat COLOR_ZERO[] = { 0.f, 0.f, 0.f, 0.f };
 constexpr GLfloat DEPTH_ONE[] = { 1.f };
 constexpr GLfloat DEPTH_ZERO[] = { 0.f };
+constexpr GLfloat DYNAMIC_RESOLUTION_KD = 0.02f;
+constexpr GLfloat DYNAMIC_RESOLUTION_KI = 0.05f;
+constexpr GLfloat DYNAMIC_RESOLUTION_KP = 0.1f;
 constexpr GLuint  GRID_SIZE_X = 16;
 constexpr GLuint  GRID_SIZE_Y = 8;
 constexpr GLuint  GRID_SIZE_Z = 24;
+constexpr GLuint  HIZ_MAX_MIP_LEVEL = 8;
 constexpr size_t  MAX_LIGHT_ENVIRONMENTS = 1;
-constexpr size_t  MAX_LIGHT_POINTS = 1024;
+constexpr GLuint  MIN_LIGHT_INDICES = GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z * 16;
+constexpr GLuint  MIN_LIGHT_POINTS = 256;
+constexpr GLuint  RESIZE_SETTLE_FRAMES = 8;
+constexpr GLuint  SHADOW_ATLAS_SIZE = 4096;
 constexpr GLuint  SHADOW_CSM_SIZE = 2048;
+constexpr GLuint  SHADOW_CUBE_MIN_SIZE = 64;
 constexpr GLuint  SHADOW_CUBE_SIZE = 1024;
 constexpr GLuint  TEXTURE_SIZE = 1024;
 
@@ -39,6 +50,69 @@ static GLuint ComputeMipLevel(const glm::uvec2 &extent) {
     return mipLevel;
 }
 
+static float ComputeHalton(std::uint32_t index, std::uint32_t base) {
+    auto fraction = 1.f;
+    auto result = 0.f;
+
+    while (index > 0) {
+        fraction /= static_cast<float>(base);
+        result += fraction * static_cast<float>(index % base);
+        index /= base;
+    }
+
+    return result;
+}
+
+// Cycles through the pixels of every 2x2 block, so four frames of interleaved AO cover the screen
+static glm::ivec2 ComputeInterleaveOffset(std::uint32_t frame) {
+    const auto OFFSETS = std::array<glm::ivec2, 4> { glm::ivec2(0, 0), glm::ivec2(1, 1), glm::ivec2(1, 0), glm::ivec2(0, 1) };
+
+    return OFFSETS[frame % OFFSETS.size()];
+}
+
+static glm::uvec2 ComputeMipExtent(const glm::uvec2 &extent, GLuint mipLevel) {
+    return glm::max(glm::uvec2(extent.x >> mipLevel, extent.y >> mipLevel), glm::uvec2(1u));
+}
+
+// Grows by doubling so buffers sized from per-frame counts settle after a few reallocations
+static GLsizei ComputeCapacity(size_t count, GLsizei capacity) {
+    while (static_cast<size_t>(capacity) < count) {
+        capacity *= 2;
+    }
+
+    return capacity;
+}
+
+// Smaller tiles and more slices as lights get denser, so clusters keep roughly the same number of lights
+static glm::uvec3 ComputeClusterGridSize(const glm::uvec2 &extent, size_t numLightPoints) {
+    const auto tileSize = numLightPoints <= 256 ? 128u : numLightPoints <= 4096 ? 64u : 32u;
+    const auto numSlices = numLightPoints <= 256 ? 16u : numLightPoints <= 4096 ? 24u : 32u;
+
+    return glm::uvec3((extent + glm::uvec2(tileSize - 1)) / tileSize, numSlices);
+}
+
+static GLuint ComputeShadowCubeSize(const glm::uvec2 &extent, const Camera *camera, const LightPoint *lightPoint) {
+    if (!camera) {
+        return SHADOW_CUBE_MIN_SIZE;
+    }
+
+    const auto distance = glm::distance(camera->m_Position, lightPoint->m_Position);
+
+    if (distance <= lightPoint->m_Radius) {
+        return SHADOW_CUBE_SIZE;
+    }
+
+    // Face resolution follows the light sphere's projected radius in pixels
+    const auto projectedRadius = lightPoint->m_Radius / (distance * glm::tan(glm::radians(camera->m_FovY) * 0.5f)) * extent.y * 0.5f;
+    auto size = SHADOW_CUBE_MIN_SIZE;
+
+    while (size < projectedRadius && size < SHADOW_CUBE_SIZE) {
+        size *= 2;
+    }
+
+    return size;
+}
+
 static void GLAPIENTRY DebugMessageCallback(
     GLenum source, 
     GLenum type, 
@@ -122,19 +196,43 @@ static void GLAPIENTRY DebugMessageCallback(
 }
 
 Render::Render() {
-    if (g_Window) {
+    m_Context = nullptr;
+
+    if (g_Window && g_Window->m_Window) {
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
 
         m_Context = SDL_GL_CreateContext(g_Window->m_Window);
+
+        SDL_GL_SetSwapInterval(0);
+    } else if (g_Window && g_Window->m_Surface != EGL_NO_SURFACE) {
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 6,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE,
+        };
+
+        eglBindAPI(EGL_OPENGL_API);
+
+        m_Context = eglCreateContext(g_Window->m_Display, g_Window->m_Config, EGL_NO_CONTEXT, contextAttributes);
+
+        if (m_Context && !eglMakeCurrent(g_Window->m_Display, g_Window->m_Surface, g_Window->m_Surface, m_Context)) {
+            eglDestroyContext(g_Window->m_Display, m_Context);
+
+            m_Context = nullptr;
+        }
     }
-    
-    SDL_GL_SetSwapInterval(0);
 
     if (m_Context) {
         auto result = glewInit();
 
+        // GLEW built against GLX reports a missing X display for EGL contexts, but core entry points are already loaded
+        if (result == GLEW_ERROR_NO_GLX_DISPLAY && !g_Window->m_Window) {
+            result = GLEW_OK;
+        }
+
         if (result == GLEW_OK) {
             glEnable(GL_DEPTH_CLAMP);
             glEnable(GL_DEBUG_OUTPUT);;
@@ -144,7 +242,7 @@ Render::Render() {
             glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
             glDebugMessageCallback(DebugMessageCallback, nullptr);
 
-            // Bind empty vertex array object to avoid crash
+            // Vertices are pulled from storage buffers, the vertex array object only holds the element buffer
             auto emptyVAO = 0u;
 
             glGenVertexArrays(1, &emptyVAO);
@@ -155,38 +253,68 @@ Render::Render() {
             m_AmbientOcclusionNumSamples = 4;
             m_AmbientOcclusionNumSlices = 4;
             m_AmbientOcclusionRadius = 4.f;
+            m_AmbientOcclusionResolution = AmbientOcclusionResolution::Full;
+            m_ClusterGridSize = glm::uvec3(GRID_SIZE_X, GRID_SIZE_Y, GRID_SIZE_Z);
+            m_ClusterUpdate = true;
             m_DrawFlags = DrawFlags::Lighting;
             m_DrawableActiveCamera = nullptr;
             m_DrawableLightEnvironment = nullptr;
             m_DrawableLightPoints = {};
             m_EnableAmbientOcclusion = true;
+            m_EnableAmbientOcclusionInterleaving = false;
+            m_EnableAutoClusterGridSize = true;
+            m_EnableConeCulling = true;
+            m_EnableDynamicResolution = false;
+            m_EnableFrustumCulling = true;
+            m_EnableOcclusionCulling = true;
             m_EnableReverseZ = true;
             m_EnableVSync = false;
             m_EnableWireframeMode = false;
+            m_FrameTimeErrors = {};
+            m_LastClusterGridSize = glm::uvec3(0);
+            m_LastClusterProjection = glm::mat4(0.f);
+            m_LodThreshold = 1.f;
+            m_LastAmbientOcclusionResolution = m_AmbientOcclusionResolution;
+            m_LastEnableAmbientOcclusionInterleaving = m_EnableAmbientOcclusionInterleaving;
+            m_LastEnableReverseZ = m_EnableReverseZ;
+            m_LastProfilerFrame = 0;
             m_NumFrames = 0;
+            m_RenderScale = 1.f;
             m_ShadowCsmFilterRadius = 2.f;
             m_ShadowCsmVarianceMax = 0.00008f;
             m_ShadowCubeFilterRadius = 2.f;
             m_ShadowCubeVarianceMax = 0.00008f;
+            m_TargetFrameTime = 8.33f;
+            m_Profiler = std::make_unique<Profiler>();
 
             // Create buffers
-            m_CameraBuffer = std::make_unique<Buffer<GpuCamera>>();
+            m_CameraBuffer = std::make_unique<RingBuffer<GpuCamera>>();
             m_ClusterBuffer = std::make_unique<Buffer<GpuCluster>>(GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z);
             m_LightCounterBuffer = std::make_unique<Buffer<std::uint32_t>>();
+            m_DownsampleDepthCounterBuffer = std::make_unique<const Buffer<std::uint32_t>>();
+            m_LightCounterFences = {};
+            m_LightCounterReadbackBuffer = std::make_unique<const Buffer<std::uint32_t>>(m_LightCounterFences.size());
             m_LightGridBuffer = std::make_unique<const Buffer<GpuLightGrid>>(GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z);
-            m_LightIndexBuffer = std::make_unique<const Buffer<std::uint32_t>>(GRID_SIZE_X * GRID_SIZE_Y * GRID_SIZE_Z * MAX_LIGHT_POINTS);
+            m_LightIndexBuffer = std::make_unique<const Buffer<std::uint32_t>>(MIN_LIGHT_INDICES);
+            m_LightEnvironmentBuffer = std::make_unique<RingBuffer<GpuLightEnvironment>>();
+            m_LightPointBuffer = std::make_unique<RingBuffer<GpuLightPoint>>(MIN_LIGHT_POINTS);
+            m_MeshletDrawCountBuffer = std::make_unique<const Buffer<std::uint32_t>>();
+            m_ShadowCubeBuffer = std::make_unique<RingBuffer<GpuShadowCube>>(MIN_LIGHT_POINTS);
+            m_ShadowDrawCountBuffer = std::make_unique<const Buffer<std::uint32_t>>();
+            m_ShadowDrawIndirectBuffer = std::make_unique<const DrawIndirectBuffer>();
+            m_ShadowViewBuffer = std::make_unique<RingBuffer<GpuShadowView>>();
 
             // Create framebuffers
             m_AmbientOcclusionFramebuffer = std::make_unique<const Framebuffer>();
             m_AmbientOcclusionSpartialFramebuffer = std::make_unique<const Framebuffer>();
             m_AmbientOcclusionTemporalFramebuffer = std::make_unique<const Framebuffer>();
             m_DepthFramebuffer = std::make_unique<const Framebuffer>();
-            m_DownsampleDepthFramebuffer = std::make_unique<const Framebuffer>();
             m_LastDepthFramebuffer = std::make_unique<const Framebuffer>();
             m_LastLightingFramebuffer = std::make_unique<const Framebuffer>();
             m_LightingFramebuffer = std::make_unique<const Framebuffer>();
             m_ShadowCsmFramebuffer = std::make_unique<const Framebuffer>();
             m_ShadowCubeFramebuffer = std::make_unique<const Framebuffer>();
+            m_UpscaleFramebuffer = std::make_unique<const Framebuffer>();
 
             // Create samplers
             m_SamplerBorderWhite = std::make_unique<const Sampler>();
@@ -235,14 +363,20 @@ Render::Render() {
 
             m_DepthShaderProgram = std::make_unique<const ShaderProgram>();
             assert(m_DepthShaderProgram->Link(GL_VERTEX_SHADER, g_ResourcePath / "shaders" / "depth.vert"));
+            assert(m_DepthShaderProgram->Link(GL_FRAGMENT_SHADER, g_ResourcePath / "shaders" / "depth.frag"));
 
             m_DownsampleDepthShaderProgram = std::make_unique<const ShaderProgram>();
-            assert(m_DownsampleDepthShaderProgram->Link(GL_VERTEX_SHADER, g_ResourcePath / "shaders" / "downsample_depth.vert"));
-            assert(m_DownsampleDepthShaderProgram->Link(GL_FRAGMENT_SHADER, g_ResourcePath / "shaders" / "downsample_depth.frag"));
+            assert(m_DownsampleDepthShaderProgram->Link(GL_COMPUTE_SHADER, g_ResourcePath / "shaders" / "downsample_depth.comp"));
 
             m_LightCullingShaderProgram = std::make_unique<const ShaderProgram>();
             assert(m_LightCullingShaderProgram->Link(GL_COMPUTE_SHADER, g_ResourcePath / "shaders" / "light_culling.comp"));
 
+            m_MeshCullingShaderProgram = std::make_unique<const ShaderProgram>();
+            assert(m_MeshCullingShaderProgram->Link(GL_COMPUTE_SHADER, g_ResourcePath / "shaders" / "cull_meshes.comp"));
+
+            m_MeshletCullingShaderProgram = std::make_unique<const ShaderProgram>();
+            assert(m_MeshletCullingShaderProgram->Link(GL_COMPUTE_SHADER, g_ResourcePath / "shaders" / "cull_meshlets.comp"));
+
             m_LightingShaderProgram = std::make_unique<const ShaderProgram>();
             assert(m_LightingShaderProgram->Link(GL_VERTEX_SHADER, g_ResourcePath / "shaders" / "lighting.vert"));
             assert(m_LightingShaderProgram->Link(GL_FRAGMENT_SHADER, g_ResourcePath / "shaders" / "lighting.frag"));
@@ -259,35 +393,37 @@ Render::Render() {
             assert(m_ShadowCubeShaderProgram->Link(GL_VERTEX_SHADER, g_ResourcePath / "shaders" / "shadow_cube.vert"));
             assert(m_ShadowCubeShaderProgram->Link(GL_FRAGMENT_SHADER, g_ResourcePath / "shaders" / "shadow_cube.frag"));
 
+            m_ShadowCullingShaderProgram = std::make_unique<const ShaderProgram>();
+            assert(m_ShadowCullingShaderProgram->Link(GL_COMPUTE_SHADER, g_ResourcePath / "shaders" / "cull_shadows.comp"));
+
+            m_UpscaleShaderProgram = std::make_unique<const ShaderProgram>();
+            assert(m_UpscaleShaderProgram->Link(GL_VERTEX_SHADER, g_ResourcePath / "shaders" / "upscale.vert"));
+            assert(m_UpscaleShaderProgram->Link(GL_FRAGMENT_SHADER, g_ResourcePath / "shaders" / "upscale.frag"));
+
             // Create textures
-            const auto screenExtent = glm::uvec2(g_Window->m_ScreenWidth, g_Window->m_ScreenHeight);
-            const auto screenMipLevel = ComputeMipLevel(screenExtent);
-
-            m_AmbientOcclusionTexture2D = std::make_unique<const Texture2D>(screenExtent , 1, GL_R16F);
-            m_AmbientOcclusionSpartialTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_R16F);
-            m_AmbientOcclusionTemporalTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_R16F);
-            m_DepthTexture2D = std::make_unique<const Texture2D>(screenExtent, screenMipLevel, GL_DEPTH_COMPONENT32F);
-            m_LastAmbientOcclusionTemporalTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_R16F);
-            m_LastDepthTexture2D = std::make_unique<const Texture2D>(screenExtent, screenMipLevel, GL_DEPTH_COMPONENT32F);
-            m_LightingTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_RGBA16F);
             m_ShadowCsmColorTexture2DArray = std::make_unique<const Texture2DArray>(glm::uvec3(SHADOW_CSM_SIZE, SHADOW_CSM_SIZE, 5u), 1, GL_R32F);
             m_ShadowCsmDepthTexture2DArray = std::make_unique<const Texture2DArray>(glm::uvec3(SHADOW_CSM_SIZE, SHADOW_CSM_SIZE, 5u), 1, GL_DEPTH_COMPONENT32F);
-            m_ShadowCubeColorTextureCubeArray = std::make_unique<const TextureCubeArray>(glm::uvec3(SHADOW_CUBE_SIZE, SHADOW_CUBE_SIZE, 6u), 1, GL_R32F);
-            m_ShadowCubeDepthTextureCubeArray = std::make_unique<const TextureCubeArray>(glm::uvec3(SHADOW_CUBE_SIZE, SHADOW_CUBE_SIZE, 6u), 1, GL_DEPTH_COMPONENT32F);
-
-            // Create texture views
-            m_DepthTextureView2Ds = std::vector<std::unique_ptr<const TextureView2D>>();
-            m_LastDepthTextureView2Ds = std::vector<std::unique_ptr<const TextureView2D>>();
-            m_ShadowCubeColorTextureViewCubes = std::vector<std::unique_ptr<const TextureViewCube>>();
-            m_ShadowCubeDepthTextureViewCubes = std::vector<std::unique_ptr<const TextureViewCube>>();
-
-            for (auto i = 0u; i < screenMipLevel; i++) {
-                m_DepthTextureView2Ds.push_back(std::make_unique<const TextureView2D>(m_DepthTexture2D.get(), i, screenMipLevel - i, 0));
-                m_LastDepthTextureView2Ds.push_back(std::make_unique<const TextureView2D>(m_LastDepthTexture2D.get(), i, screenMipLevel - i, 0));
-            }
+            m_ShadowCubeColorTexture2D = std::make_unique<const Texture2D>(glm::uvec2(SHADOW_ATLAS_SIZE), 1, GL_R16);
+            m_ShadowCubeDepthTexture2D = std::make_unique<const Texture2D>(glm::uvec2(SHADOW_ATLAS_SIZE), 1, GL_DEPTH_COMPONENT16);
 
-            m_ShadowCubeColorTextureViewCubes.push_back(std::make_unique<const TextureViewCube>(m_ShadowCubeColorTextureCubeArray.get(), 0, 1, 0));
-            m_ShadowCubeDepthTextureViewCubes.push_back(std::make_unique<const TextureViewCube>(m_ShadowCubeDepthTextureCubeArray.get(), 0, 1, 0));
+            // Create screen-sized textures and their views
+            const auto screenExtent = glm::uvec2(g_Window->m_ScreenWidth, g_Window->m_ScreenHeight);
+
+            m_Jitter = glm::vec2(0.f);
+            m_LastRenderExtent = screenExtent;
+            m_PendingScreenExtent = screenExtent;
+            m_PendingScreenFrames = 0;
+            m_RenderExtent = screenExtent;
+
+            Resize(screenExtent);
+
+            // Point light faces share one atlas, each light gets a tile size by its screen coverage
+            m_ShadowCubeAtlas = std::make_unique<Atlas>(SHADOW_ATLAS_SIZE, SHADOW_CUBE_MIN_SIZE);
+            m_ShadowCubeAtlasGeneration = 0;
+            m_LightPointSlots = std::vector<std::int32_t>();
+            m_ShadowCubeSlots = std::vector<ShadowCubeSlot>();
+            m_ShadowCubeSlotsUsed = std::vector<bool>();
+            m_ShadowCubeUpdates = std::vector<std::tuple<GLuint, GLuint>>();
         } else {
             std::cout << "Can't initialize GLEW. " << glewGetErrorString(result) << std::endl;
         }
@@ -297,153 +433,218 @@ Render::Render() {
 }
 
 Render::~Render() {
-    SDL_GL_DeleteContext(m_Context);
+    for (const auto &fence : m_LightCounterFences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+
+    if (g_Window && g_Window->m_Window) {
+        SDL_GL_DeleteContext(m_Context);
+    } else if (g_Window && m_Context) {
+        eglMakeCurrent(g_Window->m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(g_Window->m_Display, m_Context);
+    }
 }
 
 void Render::LoadModel(const Model &model) {
-    if (!m_Context) {
+    if (!m_Context || !model.m_Cache) {
         return;
     }
 
-    auto diffuseImages = std::vector<const Image *>();
-    auto metalnessImages = std::vector<const Image *>();
-    auto normalImages = std::vector<const Image *>();
-    auto roughnessImages = std::vector<const Image *>();
+    auto diffuseImages = std::vector<const CompressedImage *>();
+    auto metalnessImages = std::vector<const CompressedImage *>();
+    auto normalImages = std::vector<const CompressedImage *>();
+    auto roughnessImages = std::vector<const CompressedImage *>();
+    auto materials = std::vector<GpuMaterial>();
 
-    for (const auto &material : model.m_Materials) {
-        if (material.m_DiffuseImage) {
-            diffuseImages.push_back(material.m_DiffuseImage.get());
-        }
-        if (material.m_MetalnessImage) {
-            metalnessImages.push_back(material.m_MetalnessImage.get());
-        }
-        if (material.m_NormalImage) {
-            normalImages.push_back(material.m_NormalImage.get());
+    // Images shared between materials occupy a single layer
+    const auto findLayer = [](std::vector<const CompressedImage *> &images, const CompressedImage *image) -> GLuint {
+        if (!image) {
+            return -1;
         }
-        if (material.m_RoughnessImage) {
-            roughnessImages.push_back(material.m_RoughnessImage.get());
+
+        const auto it = std::find(images.begin(), images.end(), image);
+
+        if (it != images.end()) {
+            return std::distance(images.begin(), it);
         }
+
+        images.push_back(image);
+
+        return images.size() - 1;
+    };
+
+    for (const auto &material : model.m_Materials) {
+        materials.push_back(GpuMaterial {
+            .m_DiffuseMap = findLayer(diffuseImages, material.m_DiffuseImage.get()),
+            .m_MetalnessMap = findLayer(metalnessImages, material.m_MetalnessImage.get()),
+            .m_NormalMap = findLayer(normalImages, material.m_NormalImage.get()),
+            .m_RoughnessMap = findLayer(roughnessImages, material.m_RoughnessImage.get()),
+        });
     }
 
     // Load textures
     // Use texture arrays because my GPU doesn't support bindless textures
+    // Images are block compressed with their mips, diffuse as BC7, normal as BC5, metalness and roughness as BC4
     auto diffuseTexture2DArray = std::unique_ptr<const Texture2DArray>();
     auto metalnessTexture2DArray = std::unique_ptr<const Texture2DArray>();
     auto normalTexture2DArray = std::unique_ptr<const Texture2DArray>();
     auto roughnessTexture2DArray = std::unique_ptr<const Texture2DArray>();
 
-    const auto extent = glm::uvec3(glm::uvec2(TEXTURE_SIZE), diffuseImages.size());
+    const auto extent = glm::uvec2(TEXTURE_SIZE);
     const auto mipLevel = ComputeMipLevel(extent);
 
     if (diffuseImages.size() > 0) {
-        diffuseTexture2DArray = std::make_unique<const Texture2DArray>(extent, mipLevel, GL_RGB8);
+        diffuseTexture2DArray = std::make_unique<const Texture2DArray>(glm::uvec3(extent, diffuseImages.size()), mipLevel, GL_COMPRESSED_RGBA_BPTC_UNORM);
     }
     if (metalnessImages.size() > 0) {
-        metalnessTexture2DArray = std::make_unique<const Texture2DArray>(extent, mipLevel, GL_R8);
+        metalnessTexture2DArray = std::make_unique<const Texture2DArray>(glm::uvec3(extent, metalnessImages.size()), mipLevel, GL_COMPRESSED_RED_RGTC1);
     }
     if (normalImages.size() > 0) {
-        normalTexture2DArray = std::make_unique<const Texture2DArray>(extent, mipLevel, GL_RGB8);
+        normalTexture2DArray = std::make_unique<const Texture2DArray>(glm::uvec3(extent, normalImages.size()), mipLevel, GL_COMPRESSED_RG_RGTC2);
     }
     if (roughnessImages.size() > 0) {
-        roughnessTexture2DArray = std::make_unique<const Texture2DArray>(extent, mipLevel, GL_R8);
+        roughnessTexture2DArray = std::make_unique<const Texture2DArray>(glm::uvec3(extent, roughnessImages.size()), mipLevel, GL_COMPRESSED_RED_RGTC1);
     }
 
     for (auto i = 0u; i < diffuseImages.size(); i++) {
-        diffuseTexture2DArray->Upload(diffuseImages[i], glm::uvec3(0, 0, i), 0);
+        diffuseTexture2DArray->Upload(diffuseImages[i], glm::uvec3(0, 0, i));
     }
     for (auto i = 0u; i < metalnessImages.size(); i++) {
-        metalnessTexture2DArray->Upload(metalnessImages[i], glm::uvec3(0, 0, i), 0);
+        metalnessTexture2DArray->Upload(metalnessImages[i], glm::uvec3(0, 0, i));
     }
     for (auto i = 0u; i < normalImages.size(); i++) {
-        normalTexture2DArray->Upload(normalImages[i], glm::uvec3(0, 0, i), 0);
+        normalTexture2DArray->Upload(normalImages[i], glm::uvec3(0, 0, i));
     }
     for (auto i = 0u; i < roughnessImages.size(); i++) {
-        roughnessTexture2DArray->Upload(roughnessImages[i], glm::uvec3(0, 0, i), 0);
+        roughnessTexture2DArray->Upload(roughnessImages[i], glm::uvec3(0, 0, i));
     }
 
-    diffuseTexture2DArray->GenerateMipMaps();
-    metalnessTexture2DArray->GenerateMipMaps();
-    normalTexture2DArray->GenerateMipMaps();
-    roughnessTexture2DArray->GenerateMipMaps();
-
     // Load buffers
     auto materialBuffer = std::make_unique<const Buffer<GpuMaterial>>(model.m_Materials.size());
 
-    auto materials = std::vector<GpuMaterial>();
-    auto numDiffuseImages = 0u;
-    auto numMetalnessImages = 0u;
-    auto numNormalImages = 0u;
-    auto numRoughnessImages = 0u;
-
-    for (const auto &material : model.m_Materials) {
-        auto gpuMaterial = GpuMaterial {
-            .m_DiffuseMap = material.m_DiffuseImage ? numDiffuseImages : -1,
-            .m_MetalnessMap = material.m_MetalnessImage ? numDiffuseImages : -1,
-            .m_NormalMap = material.m_NormalImage ? numNormalImages : -1,
-            .m_RoughnessMap = material.m_RoughnessImage ? numRoughnessImages : -1,
-        };
-
-        numDiffuseImages += material.m_DiffuseImage ? 1 : 0;
-        numMetalnessImages += material.m_MetalnessImage ? 1 : 0;
-        numNormalImages += material.m_NormalImage ? 1 : 0;
-        numRoughnessImages += material.m_RoughnessImage ? 1 : 0;
-        
-        materials.push_back(gpuMaterial);
-    }
-
     materialBuffer->Upload(materials, 0);
 
-    auto drawIndirectBuffer = std::make_unique<const DrawIndirectBuffer>(model.m_Meshes.size());
+    auto culledDrawIndirectBuffer = std::make_unique<const DrawIndirectBuffer>(model.NumMeshes());
+    auto drawIndirectBuffer = std::make_unique<const DrawIndirectBuffer>(model.NumMeshes());
     auto indexBuffer = std::make_unique<const Buffer<GpuIndex>>(model.NumIndices());
-    auto lightEnvironmentBuffer = std::make_unique<const Buffer<GpuLightEnvironment>>();
-    auto lightPointBuffer = std::make_unique<const Buffer<GpuLightPoint>>(MAX_LIGHT_POINTS);
-    auto vertexBuffer = std::make_unique<const Buffer<GpuVertex>>(model.NumVertices());
+    auto meshBuffer = std::make_unique<const Buffer<GpuMesh>>(model.NumMeshes());
+    auto meshletBuffer = std::make_unique<const Buffer<GpuMeshlet>>(model.NumMeshlets());
+    auto meshletDrawIndirectBuffer = std::make_unique<const DrawIndirectBuffer>(model.NumMeshlets());
+    auto positionBuffer = std::make_unique<const Buffer<GpuVertexPosition>>(model.NumVertices());
+    auto attributeBuffer = std::make_unique<const Buffer<GpuVertexAttributes>>(model.NumVertices());
 
     auto meshes = std::vector<std::tuple<GLuint, GLuint>>();
-    auto indexOffset = 0u;
-    auto vertexOffset = 0u;
 
-    meshes.reserve(m_Meshes.size());
+    meshes.reserve(model.NumMeshes());
+
+    // Cooked data is laid out exactly like the buffers, upload it straight from the cache
+    for (auto i = 0u; i < model.NumMeshes(); i++) {
+        const auto &mesh = model.m_Cache->Meshes()[i];
 
-    for (const auto &mesh : model.m_Meshes) {
-        auto drawIndirectCommand = DrawIndirectCommand {
-            .m_NumVertices = static_cast<GLuint>(mesh.m_Indices.size()),
+        // Source commands draw the full detail level, culling swaps in coarser ranges
+        auto drawIndirectCommand = DrawElementsIndirectCommand {
+            .m_NumIndices = mesh.m_Lods[0].m_NumIndices,
             .m_NumInstances = 1,
-            .m_FirstVertex = indexOffset,
-            .m_FirstInstance = static_cast<GLuint>(meshes.size()),
+            .m_FirstIndex = mesh.m_Lods[0].m_FirstIndex,
+            .m_BaseVertex = 0,
+            .m_FirstInstance = i,
         };
 
-        auto indices = std::vector<std::uint32_t>();
-
-        indices.reserve(mesh.m_Indices.size());
+        // Bounds serve both culling and dequantizing positions
+        auto gpuMesh = GpuMesh {
+            .m_BoundsMax = mesh.m_BoundsMax,
+            .m_Material = mesh.m_Material,
+            .m_BoundsMin = mesh.m_BoundsMin,
+            .m_NumLods = mesh.m_NumLods,
+            .m_LodErrors = glm::vec4(0.f),
+            .m_LodRanges = {},
+        };
 
-        for (const auto &index : mesh.m_Indices) {
-            indices.push_back(vertexOffset + index);
+        for (auto j = 0u; j < mesh.m_NumLods; j++) {
+            gpuMesh.m_LodErrors[j] = mesh.m_Lods[j].m_Error;
+            gpuMesh.m_LodRanges[j] = glm::uvec2(mesh.m_Lods[j].m_FirstIndex, mesh.m_Lods[j].m_NumIndices);
         }
 
-        auto &vertices = mesh.m_Vertices;
-
-        drawIndirectBuffer->Upload(drawIndirectCommand, meshes.size());
-        indexBuffer->Upload(indices, indexOffset);
-        vertexBuffer->Upload(vertices, vertexOffset);
-
-        indexOffset += indices.size();
-        vertexOffset += vertices.size();
+        drawIndirectBuffer->Upload(drawIndirectCommand, i);
+        meshBuffer->Upload(gpuMesh, i);
 
-        meshes.push_back(std::make_tuple(indexOffset, indices.size()));
+        meshes.push_back(std::make_tuple(mesh.m_Lods[0].m_FirstIndex, mesh.m_Lods[0].m_NumIndices));
     }
 
+    indexBuffer->Upload(model.m_Cache->Indices(), model.NumIndices(), 0);
+    meshletBuffer->Upload(model.m_Cache->Meshlets(), model.NumMeshlets(), 0);
+    positionBuffer->Upload(model.m_Cache->Positions(), model.NumVertices(), 0);
+    attributeBuffer->Upload(model.m_Cache->Attributes(), model.NumVertices(), 0);
+
+    m_AttributeBuffer = std::move(attributeBuffer);
+    m_CulledDrawIndirectBuffer = std::move(culledDrawIndirectBuffer);
     m_DiffuseTexture2DArray = std::move(diffuseTexture2DArray);
     m_DrawIndirectBuffer = std::move(drawIndirectBuffer);
     m_IndexBuffer = std::move(indexBuffer);
-    m_LightEnvironmentBuffer = std::move(lightEnvironmentBuffer);
-    m_LightPointBuffer = std::move(lightPointBuffer);
     m_MaterialBuffer = std::move(materialBuffer);
+    m_MeshBuffer = std::move(meshBuffer);
     m_Meshes = std::move(meshes);
+    m_MeshletBuffer = std::move(meshletBuffer);
+    m_MeshletDrawIndirectBuffer = std::move(meshletDrawIndirectBuffer);
     m_MetalnessTexture2DArray = std::move(metalnessTexture2DArray);
     m_NormalTexture2DArray = std::move(normalTexture2DArray);
+    m_PositionBuffer = std::move(positionBuffer);
     m_RoughnessTexture2DArray = std::move(roughnessTexture2DArray);
-    m_VertexBuffer = std::move(vertexBuffer);
+
+    // Casters changed, every cached shadow cube is stale
+    for (auto &slot : m_ShadowCubeSlots) {
+        slot.m_IsDirty = true;
+    }
+}
+
+// Reallocates only the targets that follow the window size, the history in them is dropped.
+// Screen-sized targets are allocated at the full screen extent, while every pass renders into the
+// m_RenderExtent corner of them, so render scale changes never reallocate. Shaders clamp their reads
+// to that extent (or to g_LastRenderExtent for history) instead of the texture size.
+void Render::Resize(const glm::uvec2 &screenExtent) {
+    const auto hiZExtent = glm::max(screenExtent / 2u, glm::uvec2(1u));
+
+    // Image units bound by the single downsample dispatch cap the pyramid depth
+    const auto hiZMipLevel = std::min(ComputeMipLevel(hiZExtent), HIZ_MAX_MIP_LEVEL);
+
+    // Views share the storage of their textures, dropping them first lets the old allocations go
+    m_AmbientOcclusionTextureView2Ds = std::vector<std::unique_ptr<const TextureView2D>>();
+    m_AmbientOcclusionSpartialTextureView2Ds = std::vector<std::unique_ptr<const TextureView2D>>();
+    m_AmbientOcclusionTemporalTextureView2Ds = std::vector<std::unique_ptr<const TextureView2D>>();
+    m_HiZTextureView2Ds = std::vector<std::unique_ptr<const TextureView2D>>();
+    m_LastAmbientOcclusionTemporalTextureView2Ds = std::vector<std::unique_ptr<const TextureView2D>>();
+    m_LastHiZTextureView2Ds = std::vector<std::unique_ptr<const TextureView2D>>();
+
+    m_AmbientOcclusionTexture2D = std::make_unique<const Texture2D>(screenExtent, AMBIENT_OCCLUSION_MIP_LEVEL, GL_R16F);
+    m_AmbientOcclusionSpartialTexture2D = std::make_unique<const Texture2D>(screenExtent, AMBIENT_OCCLUSION_MIP_LEVEL, GL_R16F);
+    m_AmbientOcclusionTemporalTexture2D = std::make_unique<const Texture2D>(screenExtent, AMBIENT_OCCLUSION_MIP_LEVEL, GL_R16F);
+    m_DepthTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_DEPTH_COMPONENT32F);
+    m_HiZTexture2D = std::make_unique<const Texture2D>(hiZExtent, hiZMipLevel, GL_R32F);
+    m_LastAmbientOcclusionTemporalTexture2D = std::make_unique<const Texture2D>(screenExtent, AMBIENT_OCCLUSION_MIP_LEVEL, GL_R16F);
+    m_LastDepthTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_DEPTH_COMPONENT32F);
+    m_LastHiZTexture2D = std::make_unique<const Texture2D>(hiZExtent, hiZMipLevel, GL_R32F);
+    m_LastUpscaleTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_RGBA16F);
+    m_LightingTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_RGBA16F);
+    m_UpscaleTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_RGBA16F);
+    m_VelocityTexture2D = std::make_unique<const Texture2D>(screenExtent, 1, GL_RG16F);
+
+    for (auto i = 0u; i < AMBIENT_OCCLUSION_MIP_LEVEL; i++) {
+        m_AmbientOcclusionTextureView2Ds.push_back(std::make_unique<const TextureView2D>(m_AmbientOcclusionTexture2D.get(), i, 1, 0));
+        m_AmbientOcclusionSpartialTextureView2Ds.push_back(std::make_unique<const TextureView2D>(m_AmbientOcclusionSpartialTexture2D.get(), i, 1, 0));
+        m_AmbientOcclusionTemporalTextureView2Ds.push_back(std::make_unique<const TextureView2D>(m_AmbientOcclusionTemporalTexture2D.get(), i, 1, 0));
+        m_LastAmbientOcclusionTemporalTextureView2Ds.push_back(std::make_unique<const TextureView2D>(m_LastAmbientOcclusionTemporalTexture2D.get(), i, 1, 0));
+    }
+
+    for (auto i = 0u; i < hiZMipLevel; i++) {
+        m_HiZTextureView2Ds.push_back(std::make_unique<const TextureView2D>(m_HiZTexture2D.get(), i, hiZMipLevel - i, 0));
+        m_LastHiZTextureView2Ds.push_back(std::make_unique<const TextureView2D>(m_LastHiZTexture2D.get(), i, hiZMipLevel - i, 0));
+    }
+
+    m_ClusterUpdate = true;
+    m_IsHistoryValid = false;
+    m_ScreenExtent = screenExtent;
 }
 
 void Render::Update() {
@@ -451,26 +652,87 @@ void Render::Update() {
         return;
     }
 
-    if (m_EnableVSync) {
-        if (SDL_GL_GetSwapInterval() != 1) {
-            SDL_GL_SetSwapInterval(1);
+    if (g_Window->m_Window) {
+        if (m_EnableVSync) {
+            if (SDL_GL_GetSwapInterval() != 1) {
+                SDL_GL_SetSwapInterval(1);
+            }
+        } else {
+            if (SDL_GL_GetSwapInterval() != 0) {
+                SDL_GL_SetSwapInterval(0);
+            }
         }
-    } else {
-        if (SDL_GL_GetSwapInterval() != 0) {
-            SDL_GL_SetSwapInterval(0);
+    }
+
+    assert(m_CameraBuffer);
+    assert(m_LightCounterBuffer);
+    assert(m_LightEnvironmentBuffer);
+    assert(m_LightPointBuffer);
+    assert(m_ShadowCubeBuffer);
+    assert(m_ShadowViewBuffer);
+
+    // Resizing waits for the window size to hold still, so dragging the border doesn't reallocate every frame
+    const auto windowExtent = glm::uvec2(g_Window->m_ScreenWidth, g_Window->m_ScreenHeight);
+
+    if (windowExtent != m_PendingScreenExtent) {
+        m_PendingScreenExtent = windowExtent;
+        m_PendingScreenFrames = 0;
+    } else if (windowExtent != m_ScreenExtent && windowExtent.x > 0 && windowExtent.y > 0 && ++m_PendingScreenFrames >= RESIZE_SETTLE_FRAMES) {
+        Resize(windowExtent);
+    }
+
+    // Render extent is the scaled part of the screen-sized targets, see Resize
+    const auto screenExtent = m_ScreenExtent;
+
+    // PID in velocity form steers the scale towards the frame time budget, once per resolved GPU frame
+    if (m_EnableDynamicResolution) {
+        if (!m_Profiler->m_LastSamples.empty() && m_Profiler->m_LastFrame != m_LastProfilerFrame) {
+            // Frame scope is opened first, so it leads the samples
+            const auto frameTime = m_Profiler->m_LastSamples.front().m_Time;
+            const auto error = (m_TargetFrameTime - frameTime) / std::max(m_TargetFrameTime, 0.001f);
+
+            m_RenderScale += DYNAMIC_RESOLUTION_KP * (error - m_FrameTimeErrors[0])
+                + DYNAMIC_RESOLUTION_KI * error
+                + DYNAMIC_RESOLUTION_KD * (error - 2.f * m_FrameTimeErrors[0] + m_FrameTimeErrors[1]);
+            m_FrameTimeErrors = { error, m_FrameTimeErrors[0] };
+            m_LastProfilerFrame = m_Profiler->m_LastFrame;
         }
+    } else {
+        m_FrameTimeErrors = {};
+    }
+
+    m_RenderScale = glm::clamp(m_RenderScale, 0.5f, 1.f);
+    m_LastRenderExtent = m_RenderExtent;
+    m_RenderExtent = glm::clamp(glm::uvec2(glm::round(glm::vec2(screenExtent) * m_RenderScale)), glm::uvec2(1u), screenExtent);
+
+    // Upscaling gathers sub-pixel detail over frames jittered along a Halton sequence
+    if (m_RenderExtent != screenExtent) {
+        m_Jitter = glm::vec2(ComputeHalton(m_NumFrames % 8 + 1, 2), ComputeHalton(m_NumFrames % 8 + 1, 3)) - 0.5f;
+    } else {
+        m_Jitter = glm::vec2(0.f);
     }
 
-    auto cameraUploadData = std::vector<GpuCamera>();
-    auto lightEnvironmentUploadData = std::vector<GpuLightEnvironment>();
-    auto lightPointUploadData = std::vector<GpuLightPoint>();
-    auto numLightPointShadows = 0u;
+    if (m_EnableAutoClusterGridSize) {
+        m_ClusterGridSize = ComputeClusterGridSize(m_RenderExtent, m_DrawableLightPoints.size());
+    }
+
+    m_ClusterGridSize = glm::clamp(m_ClusterGridSize, glm::uvec3(1), glm::uvec3(64, 64, 32));
+
+    const auto numClusters = m_ClusterGridSize.x * m_ClusterGridSize.y * m_ClusterGridSize.z;
+
+    if (m_ClusterBuffer->m_Count < numClusters) {
+        m_ClusterBuffer = std::make_unique<const Buffer<GpuCluster>>(ComputeCapacity(numClusters, m_ClusterBuffer->m_Count));
+        m_LightGridBuffer = std::make_unique<const Buffer<GpuLightGrid>>(ComputeCapacity(numClusters, m_LightGridBuffer->m_Count));
+        m_ClusterUpdate = true;
+    }
 
     if (m_DrawableActiveCamera) {
         static glm::mat4 lastView = glm::identity<glm::mat4>();
 
-        const auto projection = m_DrawableActiveCamera->Projection(m_EnableReverseZ);
-        const auto projectionNonReversed = m_EnableReverseZ ? m_DrawableActiveCamera->Projection(false) : projection;
+        const auto jitter = glm::translate(glm::identity<glm::mat4>(), glm::vec3(2.f * m_Jitter / glm::vec2(m_RenderExtent), 0.f));
+        const auto unjitteredProjection = m_DrawableActiveCamera->Projection(m_EnableReverseZ);
+        const auto projection = jitter * unjitteredProjection;
+        const auto projectionNonReversed = m_EnableReverseZ ? m_DrawableActiveCamera->Projection(false) : unjitteredProjection;
         const auto fovY = glm::radians(m_DrawableActiveCamera->m_FovY);
         const auto halfFovY = fovY * 0.5f;
         const auto v = glm::tan(halfFovY);
@@ -478,14 +740,14 @@ void Render::Update() {
         const auto halfFovX = glm::atan(h);
         const auto fovX = halfFovX * 2.f;
         const auto view = m_DrawableActiveCamera->View();
-        const auto normTileDim = glm::vec2(1.f / static_cast<float>(GRID_SIZE_X), 1.f / static_cast<float>(GRID_SIZE_Y));
-        const auto tileSizeInv = glm::vec2(1.f / (g_Window->m_ScreenWidth * normTileDim.x), 1.f / (g_Window->m_ScreenHeight * normTileDim.y));
+        const auto normTileDim = glm::vec2(1.f / static_cast<float>(m_ClusterGridSize.x), 1.f / static_cast<float>(m_ClusterGridSize.y));
+        const auto tileSizeInv = glm::vec2(1.f / (m_RenderExtent.x * normTileDim.x), 1.f / (m_RenderExtent.y * normTileDim.y));
         const auto farZ = m_DrawableActiveCamera->m_FarZ;
         const auto nearZ = m_DrawableActiveCamera->m_NearZ;
-        const auto sliceBiasFactor = -((static_cast<float>(GRID_SIZE_Z) * std::log2(nearZ)) / std::log2(farZ / nearZ));
-        const auto sliceScalingFactor = static_cast<float>(GRID_SIZE_Z) / std::log2(farZ / nearZ);
+        const auto sliceBiasFactor = -((static_cast<float>(m_ClusterGridSize.z) * std::log2(nearZ)) / std::log2(farZ / nearZ));
+        const auto sliceScalingFactor = static_cast<float>(m_ClusterGridSize.z) / std::log2(farZ / nearZ);
 
-        cameraUploadData.push_back(GpuCamera {
+        *m_CameraBuffer->Map() = GpuCamera {
             .m_LastView = lastView,
             .m_Projection = projection,
             .m_ProjectionInversed = glm::inverse(projection),
@@ -501,11 +763,24 @@ void Render::Update() {
             .m_FovY = fovY,
             .m_SliceBiasFactor = sliceBiasFactor,
             .m_SliceScalingFactor = sliceScalingFactor,
-        });
+            .m_RenderExtent = m_RenderExtent,
+            .m_LastRenderExtent = m_LastRenderExtent,
+        };
 
         lastView = std::move(view);
+
+        // Cluster bounds only depend on the projection and the grid, the non reversed projection covers fov, aspect and near/far
+        if (m_LastClusterProjection != projectionNonReversed || m_LastClusterGridSize != m_ClusterGridSize) {
+            m_ClusterUpdate = true;
+            m_LastClusterGridSize = m_ClusterGridSize;
+            m_LastClusterProjection = projectionNonReversed;
+        }
     }
 
+    auto cascadeViewProjections = std::array<glm::mat4, 5>();
+
+    std::fill(cascadeViewProjections.begin(), cascadeViewProjections.end(), glm::identity<glm::mat4>());
+
     if (m_DrawableActiveCamera && m_DrawableLightEnvironment) {
         const auto cascadeLevels = std::array<float, 4> {
             m_DrawableActiveCamera->m_FarZ * 1.f / 80.f,
@@ -514,99 +789,311 @@ void Render::Update() {
             m_DrawableActiveCamera->m_FarZ * 1.f / 10.f,
         };
 
-        lightEnvironmentUploadData.push_back(GpuLightEnvironment {
-            .m_CascadeViewProjections = m_DrawableLightEnvironment->CascadeViewProjections(m_DrawableActiveCamera, cascadeLevels, m_EnableReverseZ),
+        cascadeViewProjections = m_DrawableLightEnvironment->CascadeViewProjections(m_DrawableActiveCamera, cascadeLevels, m_EnableReverseZ);
+
+        *m_LightEnvironmentBuffer->Map() = GpuLightEnvironment {
+            .m_CascadeViewProjections = cascadeViewProjections,
             .m_CascadePlaneDistances = cascadeLevels,
             .m_AmbientColor = m_DrawableLightEnvironment->m_AmbientColor,
             .m_BaseColor = m_DrawableLightEnvironment->m_BaseColor,
             .m_Direction = m_DrawableLightEnvironment->Forward(),
-        });
+        };
+    }
+
+    // Shadowed lights keep their cube slot between frames, slots of lights that are gone get reused
+    const auto numLightPoints = m_DrawableLightPoints.size();
+    auto &lightPointSlots = m_LightPointSlots;
+    auto &isSlotUsed = m_ShadowCubeSlotsUsed;
+
+    lightPointSlots.assign(numLightPoints, -1);
+    isSlotUsed.assign(m_ShadowCubeSlots.size(), false);
+
+    // Every release bumps the generation, so lights that fell back to a smaller tier know to retry
+    const auto freeTiles = [this](ShadowCubeSlot &slot) {
+        if (slot.m_AtlasSize > 0) {
+            for (const auto &offset : slot.m_AtlasOffsets) {
+                m_ShadowCubeAtlas->Free(offset, slot.m_AtlasSize);
+            }
+
+            m_ShadowCubeAtlasGeneration++;
+        }
+
+        slot.m_AtlasSize = 0;
+    };
+
+    const auto allocateTiles = [this](ShadowCubeSlot &slot, GLuint size) {
+        for (auto i = 0u; i < slot.m_AtlasOffsets.size(); i++) {
+            const auto offset = m_ShadowCubeAtlas->Allocate(size);
+
+            if (!offset) {
+                for (auto j = 0u; j < i; j++) {
+                    m_ShadowCubeAtlas->Free(slot.m_AtlasOffsets[j], size);
+                }
+
+                return false;
+            }
+
+            slot.m_AtlasOffsets[i] = *offset;
+        }
+
+        slot.m_AtlasSize = size;
+
+        return true;
+    };
+
+    for (auto i = 0u; i < numLightPoints; i++) {
+        const auto lightPoint = m_DrawableLightPoints[i];
+
+        for (auto j = 0u; j < m_ShadowCubeSlots.size() && lightPoint->m_CastShadows; j++) {
+            if (m_ShadowCubeSlots[j].m_LightPoint == lightPoint && !isSlotUsed[j]) {
+                lightPointSlots[i] = j;
+                isSlotUsed[j] = true;
+                break;
+            }
+        }
+    }
+
+    for (auto i = 0u; i < m_ShadowCubeSlots.size(); i++) {
+        if (!isSlotUsed[i]) {
+            freeTiles(m_ShadowCubeSlots[i]);
+
+            m_ShadowCubeSlots[i].m_LightPoint = nullptr;
+        }
+    }
+
+    for (auto i = 0u; i < numLightPoints; i++) {
+        const auto lightPoint = m_DrawableLightPoints[i];
+
+        if (!lightPoint->m_CastShadows || lightPointSlots[i] >= 0) {
+            continue;
+        }
+
+        const auto it = std::find(isSlotUsed.begin(), isSlotUsed.end(), false);
+        const auto slot = std::distance(isSlotUsed.begin(), it);
+
+        if (it == isSlotUsed.end()) {
+            m_ShadowCubeSlots.push_back(ShadowCubeSlot {});
+            isSlotUsed.push_back(true);
+        } else {
+            *it = true;
+        }
+
+        m_ShadowCubeSlots[slot] = ShadowCubeSlot {
+            .m_AtlasGeneration = 0,
+            .m_AtlasOffsets = {},
+            .m_AtlasSize = 0,
+            .m_LightPoint = lightPoint,
+            .m_Position = lightPoint->m_Position,
+            .m_Radius = lightPoint->m_Radius,
+            .m_RequestedSize = 0,
+            .m_IsDirty = true,
+        };
+        lightPointSlots[i] = slot;
+    }
+
+    for (auto i = 0u; i < numLightPoints; i++) {
+        const auto lightPoint = m_DrawableLightPoints[i];
+
+        if (lightPointSlots[i] < 0) {
+            continue;
+        }
+
+        auto &slot = m_ShadowCubeSlots[lightPointSlots[i]];
+
+        if (slot.m_Position != lightPoint->m_Position || slot.m_Radius != lightPoint->m_Radius) {
+            slot.m_Position = lightPoint->m_Position;
+            slot.m_Radius = lightPoint->m_Radius;
+            slot.m_IsDirty = true;
+        }
+
+        // Grow right away, shrink only past one tier to avoid reallocating on small camera moves
+        const auto size = ComputeShadowCubeSize(m_ScreenExtent, m_DrawableActiveCamera, lightPoint);
+
+        if (size * 2 < slot.m_AtlasSize) {
+            freeTiles(slot);
+
+            for (auto tierSize = size; tierSize >= SHADOW_CUBE_MIN_SIZE && !allocateTiles(slot, tierSize); tierSize /= 2);
+
+            slot.m_IsDirty = true;
+        } else if (size > slot.m_AtlasSize && (size != slot.m_RequestedSize || slot.m_AtlasGeneration != m_ShadowCubeAtlasGeneration)) {
+            // Fall back to smaller tiers when the atlas is full, the current tiles are only given up for a bigger tier.
+            // Lights that don't fit at all go unshadowed
+            auto grownSlot = slot;
+
+            for (auto tierSize = size; tierSize > slot.m_AtlasSize && tierSize >= SHADOW_CUBE_MIN_SIZE; tierSize /= 2) {
+                if (allocateTiles(grownSlot, tierSize)) {
+                    freeTiles(slot);
+
+                    slot.m_AtlasOffsets = grownSlot.m_AtlasOffsets;
+                    slot.m_AtlasSize = grownSlot.m_AtlasSize;
+                    slot.m_IsDirty = true;
+                    break;
+                }
+            }
+        }
+
+        // A fallback is retried only once the wanted tier changes or tiles are released
+        slot.m_AtlasGeneration = m_ShadowCubeAtlasGeneration;
+        slot.m_RequestedSize = size;
+
+        if (slot.m_AtlasSize == 0) {
+            slot.m_LightPoint = nullptr;
+            lightPointSlots[i] = -1;
+        }
     }
 
-    for (const auto &lightPoint : m_DrawableLightPoints) {
-        lightPointUploadData.push_back(GpuLightPoint {
+    while (!m_ShadowCubeSlots.empty() && !m_ShadowCubeSlots.back().m_LightPoint) {
+        m_ShadowCubeSlots.pop_back();
+    }
+
+    // Light storage grows with the scene, everything is written straight into this frame's mapped region
+    if (m_LightPointBuffer->m_Count < numLightPoints) {
+        m_LightPointBuffer = std::make_unique<RingBuffer<GpuLightPoint>>(ComputeCapacity(numLightPoints, m_LightPointBuffer->m_Count));
+    }
+    if (m_ShadowCubeBuffer->m_Count < m_ShadowCubeSlots.size()) {
+        m_ShadowCubeBuffer = std::make_unique<RingBuffer<GpuShadowCube>>(ComputeCapacity(m_ShadowCubeSlots.size(), m_ShadowCubeBuffer->m_Count));
+    }
+
+    const auto lightPoints = m_LightPointBuffer->Map();
+    const auto shadowCubes = m_ShadowCubeBuffer->Map();
+
+    for (auto i = 0u; i < m_ShadowCubeSlots.size(); i++) {
+        const auto &slot = m_ShadowCubeSlots[i];
+
+        for (auto j = 0u; j < slot.m_AtlasOffsets.size(); j++) {
+            shadowCubes[i].m_AtlasRects[j] = glm::vec4(glm::vec2(slot.m_AtlasOffsets[j]), glm::vec2(static_cast<float>(slot.m_AtlasSize))) * (1.f / SHADOW_ATLAS_SIZE);
+        }
+    }
+
+    for (auto i = 0u; i < numLightPoints; i++) {
+        const auto lightPoint = m_DrawableLightPoints[i];
+
+        lightPoints[i] = GpuLightPoint {
             .m_ViewProjections = lightPoint->ViewProjections(m_EnableReverseZ),
             .m_Position = lightPoint->m_Position,
             .m_Radius = lightPoint->m_Radius,
             .m_BaseColor = lightPoint->m_BaseColor,
-            .m_ShadowIndex = lightPoint->m_CastShadows ? static_cast<std::int32_t>(numLightPointShadows) : -1,
-        });
+            .m_ShadowIndex = lightPointSlots[i],
+        };
+    }
+
+    // Size the light index list from the counter culling wrote a few frames ago, never wait for it
+    auto &lightCounterFence = m_LightCounterFences[m_NumFrames % m_LightCounterFences.size()];
+
+    if (lightCounterFence) {
+        const auto result = glClientWaitSync(lightCounterFence, 0, 0);
+
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+            auto numLightIndices = 0u;
 
-        if (lightPoint->m_CastShadows) {
-            numLightPointShadows++;
+            m_LightCounterReadbackBuffer->Download(&numLightIndices, 1, m_NumFrames % m_LightCounterFences.size());
+
+            if (m_LightIndexBuffer->m_Count < numLightIndices) {
+                m_LightIndexBuffer = std::make_unique<const Buffer<std::uint32_t>>(ComputeCapacity(numLightIndices, m_LightIndexBuffer->m_Count));
+            }
+
+            glDeleteSync(lightCounterFence);
+
+            lightCounterFence = nullptr;
         }
     }
-    
-    assert(m_CameraBuffer);
-    assert(m_LightCounterBuffer);
-    assert(m_LightEnvironmentBuffer);
-    assert(m_LightPointBuffer);
-
-    m_CameraBuffer->Upload(cameraUploadData, 0);
-    m_LightCounterBuffer->Upload(0, 0);
-    m_LightEnvironmentBuffer->Upload(lightEnvironmentUploadData, 0);
-    m_LightPointBuffer->Upload(lightPointUploadData, 0);
 
-    // Recreate shadow cubes
-    assert(m_ShadowCubeColorTextureCubeArray);
+    m_LightCounterBuffer->Clear();
 
-    if (m_ShadowCubeColorTextureCubeArray->m_Extent.z < numLightPointShadows * 6) {
-        const auto extent = glm::uvec3(glm::uvec2(SHADOW_CUBE_SIZE), std::max(numLightPointShadows * 6lu, 6lu));
+    // Only dirty slots are culled and rendered, the rest keep last frame's contents
+    m_ShadowCubeUpdates.clear();
 
-        m_ShadowCubeColorTextureCubeArray = std::make_unique<const TextureCubeArray>(extent, 1, GL_R16);
-        m_ShadowCubeColorTextureViewCubes.clear();
-    
-        while (m_ShadowCubeColorTextureViewCubes.size() < std::max(numLightPointShadows, 1u)) {
-            m_ShadowCubeColorTextureViewCubes.push_back(
-                std::make_unique<const TextureViewCube>(
-                    m_ShadowCubeColorTextureCubeArray.get(), 
-                    0, 
-                    1, 
-                    m_ShadowCubeColorTextureViewCubes.size() * 6
-                )
-            );
+    for (auto i = 0u; i < numLightPoints; i++) {
+        if (lightPointSlots[i] >= 0 && m_ShadowCubeSlots[lightPointSlots[i]].m_IsDirty) {
+            m_ShadowCubeUpdates.push_back(std::make_tuple(i, lightPointSlots[i]));
+            m_ShadowCubeSlots[lightPointSlots[i]].m_IsDirty = false;
         }
     }
 
-    assert(m_ShadowCubeDepthTextureCubeArray);
+    // Recreate shadow draw lists, shadow casters are culled per view, cascades come first and dirty cube faces follow
+    const auto numCascades = m_ShadowCsmColorTexture2DArray->m_Extent.z;
+    const auto numShadowViews = numCascades + m_ShadowCubeUpdates.size() * 6;
+    const auto numShadowDraws = numShadowViews * std::max(m_Meshes.size(), 1lu);
 
-    if (m_ShadowCubeDepthTextureCubeArray->m_Extent.z < numLightPointShadows * 6) {
-        const auto extent = glm::uvec3(glm::uvec2(SHADOW_CUBE_SIZE), std::max(numLightPointShadows * 6lu, 6lu));
+    if (m_ShadowViewBuffer->m_Count < numShadowViews) {
+        m_ShadowDrawCountBuffer = std::make_unique<const Buffer<std::uint32_t>>(ComputeCapacity(numShadowViews, m_ShadowDrawCountBuffer->m_Count));
+        m_ShadowViewBuffer = std::make_unique<RingBuffer<GpuShadowView>>(ComputeCapacity(numShadowViews, m_ShadowViewBuffer->m_Count));
+    }
+    if (m_ShadowDrawIndirectBuffer->m_Count < numShadowDraws) {
+        m_ShadowDrawIndirectBuffer = std::make_unique<const DrawIndirectBuffer>(ComputeCapacity(numShadowDraws, m_ShadowDrawIndirectBuffer->m_Count));
+    }
 
-        m_ShadowCubeDepthTextureCubeArray = std::make_unique<TextureCubeArray>(extent, 1, GL_DEPTH_COMPONENT16);
-        m_ShadowCubeDepthTextureViewCubes.clear();
+    // Resolution lets the culling pass measure LOD errors in shadow map texels
+    const auto shadowViews = m_ShadowViewBuffer->Map();
 
-        while (m_ShadowCubeDepthTextureViewCubes.size() < std::max(numLightPointShadows, 1u)) {
-            m_ShadowCubeDepthTextureViewCubes.push_back(
-                std::make_unique<const TextureViewCube>(
-                    m_ShadowCubeDepthTextureCubeArray.get(),
-                    0,
-                    1,
-                    m_ShadowCubeDepthTextureViewCubes.size() * 6
-                )
-            );
+    for (auto i = 0u; i < numCascades; i++) {
+        shadowViews[i] = GpuShadowView {
+            .m_ViewProjection = cascadeViewProjections[i],
+            .m_Resolution = static_cast<float>(m_ShadowCsmColorTexture2DArray->m_Extent.x),
+        };
+    }
+
+    for (auto i = 0u; i < m_ShadowCubeUpdates.size(); i++) {
+        const auto [lightIndex, slot] = m_ShadowCubeUpdates[i];
+        const auto viewProjections = m_DrawableLightPoints[lightIndex]->ViewProjections(m_EnableReverseZ);
+
+        for (auto j = 0u; j < 6; j++) {
+            shadowViews[numCascades + i * 6 + j] = GpuShadowView {
+                .m_ViewProjection = viewProjections[j],
+                .m_Resolution = static_cast<float>(m_ShadowCubeSlots[slot].m_AtlasSize),
+            };
         }
     }
 
+    m_ShadowDrawCountBuffer->Clear();
+
     std::swap(m_AmbientOcclusionTemporalTexture2D, m_LastAmbientOcclusionTemporalTexture2D);
+    std::swap(m_AmbientOcclusionTemporalTextureView2Ds, m_LastAmbientOcclusionTemporalTextureView2Ds);
     std::swap(m_DepthFramebuffer, m_LastDepthFramebuffer);
     std::swap(m_DepthTexture2D, m_LastDepthTexture2D);
-    std::swap(m_DepthTextureView2Ds, m_LastDepthTextureView2Ds);
+    std::swap(m_HiZTexture2D, m_LastHiZTexture2D);
+    std::swap(m_HiZTextureView2Ds, m_LastHiZTextureView2Ds);
     std::swap(m_LightingFramebuffer, m_LastLightingFramebuffer);
+    std::swap(m_UpscaleTexture2D, m_LastUpscaleTexture2D);
 
     // Draw model
-    ShadowCsmPass();
-    ShadowCubePass();
-    DepthPass();
-    DownsampleDepthPass();
-    AmbientOcclusionPass();
-    AmbientOcclusionSpartialPass();
-    AmbientOcclusionTemporalPass();
-    ClusterPass();
-    LightCullingPass();
-    LightingPass();
-    ScreenPass();
+    const auto passes = std::array<std::tuple<const char *, void (Render::*)()>, 15> {
+        std::make_tuple("ShadowCullingPass", &Render::ShadowCullingPass),
+        std::make_tuple("ShadowCsmPass", &Render::ShadowCsmPass),
+        std::make_tuple("ShadowCubePass", &Render::ShadowCubePass),
+        std::make_tuple("MeshCullingPass", &Render::MeshCullingPass),
+        std::make_tuple("MeshletCullingPass", &Render::MeshletCullingPass),
+        std::make_tuple("DepthPass", &Render::DepthPass),
+        std::make_tuple("DownsampleDepthPass", &Render::DownsampleDepthPass),
+        std::make_tuple("AmbientOcclusionPass", &Render::AmbientOcclusionPass),
+        std::make_tuple("AmbientOcclusionSpartialPass", &Render::AmbientOcclusionSpartialPass),
+        std::make_tuple("AmbientOcclusionTemporalPass", &Render::AmbientOcclusionTemporalPass),
+        std::make_tuple("ClusterPass", &Render::ClusterPass),
+        std::make_tuple("LightCullingPass", &Render::LightCullingPass),
+        std::make_tuple("LightingPass", &Render::LightingPass),
+        std::make_tuple("UpscalePass", &Render::UpscalePass),
+        std::make_tuple("ScreenPass", &Render::ScreenPass),
+    };
+
+    m_Profiler->BeginFrame(m_NumFrames);
+
+    for (const auto &[name, pass] : passes) {
+        m_Profiler->Begin(name);
+
+        (this->*pass)();
+
+        m_Profiler->End();
+    }
 
+    m_Profiler->EndFrame();
+
+    m_CameraBuffer->Fence();
+    m_LightEnvironmentBuffer->Fence();
+    m_LightPointBuffer->Fence();
+    m_ShadowCubeBuffer->Fence();
+    m_ShadowViewBuffer->Fence();
+
+    m_IsHistoryValid = true;
     m_NumFrames++;
     
     m_DrawableActiveCamera = nullptr;
@@ -614,7 +1101,34 @@ void Render::Update() {
     m_DrawableLightPoints.clear();
 }
 
-void Render::ShadowCsmPass() {;
+void Render::ShadowCullingPass() {
+    assert(m_ShadowCullingShaderProgram);
+
+    m_ShadowCullingShaderProgram->Use();
+
+    assert(m_DrawIndirectBuffer);
+    assert(m_MeshBuffer);
+    assert(m_ShadowDrawCountBuffer);
+    assert(m_ShadowDrawIndirectBuffer);
+    assert(m_ShadowViewBuffer);
+
+    m_ShadowViewBuffer->BindStorage(0);
+    m_MeshBuffer->BindStorage(1);
+    m_DrawIndirectBuffer->BindStorage(2);
+    m_ShadowDrawIndirectBuffer->BindStorage(3);
+    m_ShadowDrawCountBuffer->BindStorage(4);
+
+    const auto numCascades = m_ShadowCsmColorTexture2DArray->m_Extent.z;
+
+    m_ShadowCullingShaderProgram->SetUniform(0, numCascades);
+    m_ShadowCullingShaderProgram->SetUniform(1, static_cast<std::uint32_t>(m_Meshes.size()));
+    m_ShadowCullingShaderProgram->SetUniform(2, m_LodThreshold);
+
+    glDispatchCompute((m_Meshes.size() + 63) / 64, numCascades + m_ShadowCubeUpdates.size() * 6, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void Render::ShadowCsmPass() {
     assert(m_ShadowCsmFramebuffer);
     assert(m_ShadowCsmShaderProgram);
 
@@ -636,20 +1150,31 @@ void Render::ShadowCsmPass() {;
     m_ShadowCsmFramebuffer->ClearColor(0, m_EnableReverseZ ? glm::vec4(0.f) : glm::vec4(1.f));
     m_ShadowCsmFramebuffer->ClearDepth(0, m_EnableReverseZ ? 0.f : 1.f);
 
-    assert(m_DrawIndirectBuffer);
     assert(m_IndexBuffer);
     assert(m_LightEnvironmentBuffer);
-    assert(m_VertexBuffer);
-
-    m_DrawIndirectBuffer->BindIndirect();
-    m_IndexBuffer->BindStorage(0);
+    assert(m_MeshBuffer);
+    assert(m_PositionBuffer);
+    assert(m_ShadowDrawCountBuffer);
+    assert(m_ShadowDrawIndirectBuffer);
+
+    m_ShadowDrawCountBuffer->BindParameter();
+    m_ShadowDrawIndirectBuffer->BindIndirect();
+    m_IndexBuffer->BindElement();
     m_LightEnvironmentBuffer->BindStorage(1);
-    m_VertexBuffer->BindStorage(2);
+    m_PositionBuffer->BindStorage(2);
+    m_MeshBuffer->BindStorage(3);
 
     for (auto i = 0u; i < m_ShadowCsmColorTexture2DArray->m_Extent.z; i++) {
         m_ShadowCsmShaderProgram->SetUniform(0, i);
 
-        glMultiDrawArraysIndirect(GL_TRIANGLES, 0, m_Meshes.size(), sizeof(DrawIndirectCommand));
+        glMultiDrawElementsIndirectCount(
+            GL_TRIANGLES, 
+            GL_UNSIGNED_INT, 
+            reinterpret_cast<const void *>(i * m_Meshes.size() * sizeof(DrawElementsIndirectCommand)), 
+            i * sizeof(GLuint), 
+            m_Meshes.size(), 
+            sizeof(DrawElementsIndirectCommand)
+        );
     }
 }
 
@@ -667,45 +1192,133 @@ void Render::ShadowCubePass() {
     glDepthMask(true);
     glFrontFace(GL_CCW);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glScissor(0, 0, m_ShadowCubeColorTextureCubeArray->m_Extent.x, m_ShadowCubeColorTextureCubeArray->m_Extent.y);
-    glViewport(0, 0, m_ShadowCubeColorTextureCubeArray->m_Extent.x, m_ShadowCubeColorTextureCubeArray->m_Extent.y);
 
-    assert(m_DrawIndirectBuffer);
+    assert(m_ShadowCubeColorTexture2D);
+    assert(m_ShadowCubeDepthTexture2D);
+
+    m_ShadowCubeFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_ShadowCubeColorTexture2D.get());
+    m_ShadowCubeFramebuffer->SetAttachment(GL_DEPTH_ATTACHMENT, m_ShadowCubeDepthTexture2D.get());
+
     assert(m_IndexBuffer);
     assert(m_LightPointBuffer);
-    assert(m_VertexBuffer);
-
-    m_DrawIndirectBuffer->BindIndirect();
-    m_IndexBuffer->BindStorage(0);
+    assert(m_MeshBuffer);
+    assert(m_PositionBuffer);
+    assert(m_ShadowDrawCountBuffer);
+    assert(m_ShadowDrawIndirectBuffer);
+
+    m_ShadowDrawCountBuffer->BindParameter();
+    m_ShadowDrawIndirectBuffer->BindIndirect();
+    m_IndexBuffer->BindElement();
     m_LightPointBuffer->BindStorage(1);
-    m_VertexBuffer->BindStorage(2);
+    m_PositionBuffer->BindStorage(2);
+    m_MeshBuffer->BindStorage(3);
 
-    auto numLightPointShadows = 0u;
+    const auto numCascades = m_ShadowCsmColorTexture2DArray->m_Extent.z;
 
-    for (auto i = 0u; i < std::min(m_DrawableLightPoints.size(), MAX_LIGHT_POINTS); i++) {
-        const auto &lightPoint = m_DrawableLightPoints[i];
+    for (auto i = 0u; i < m_ShadowCubeUpdates.size(); i++) {
+        const auto [lightIndex, slot] = m_ShadowCubeUpdates[i];
+        const auto &shadowCubeSlot = m_ShadowCubeSlots[slot];
 
-        if (!lightPoint->m_CastShadows) {
-            continue;
-        }
+        m_ShadowCubeShaderProgram->SetUniform(1, lightIndex);
 
-        m_ShadowCubeFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_ShadowCubeColorTextureViewCubes.at(numLightPointShadows).get());
-        m_ShadowCubeFramebuffer->SetAttachment(GL_DEPTH_ATTACHMENT, m_ShadowCubeDepthTextureViewCubes.at(numLightPointShadows).get());
-        m_ShadowCubeFramebuffer->ClearColor(0, glm::vec4(1.f));
-        m_ShadowCubeFramebuffer->ClearDepth(0, 1.f);
+        for (auto j = 0u; j < 6; j++) {
+            const auto &offset = shadowCubeSlot.m_AtlasOffsets[j];
+            const auto size = shadowCubeSlot.m_AtlasSize;
+            const auto view = numCascades + i * 6 + j;
 
-        m_ShadowCubeShaderProgram->SetUniform(1, i);
+            // Scissor limits the clears to this face's tile
+            glScissor(offset.x, offset.y, size, size);
+            glViewport(offset.x, offset.y, size, size);
+
+            m_ShadowCubeFramebuffer->ClearColor(0, glm::vec4(1.f));
+            m_ShadowCubeFramebuffer->ClearDepth(0, 1.f);
 
-        for (auto j = 0u; j < 6; j++) {
             m_ShadowCubeShaderProgram->SetUniform(0, j);
 
-            glMultiDrawArraysIndirect(GL_TRIANGLES, 0, m_Meshes.size(), sizeof(DrawIndirectCommand));
+            glMultiDrawElementsIndirectCount(
+                GL_TRIANGLES, 
+                GL_UNSIGNED_INT, 
+                reinterpret_cast<const void *>(view * m_Meshes.size() * sizeof(DrawElementsIndirectCommand)), 
+                view * sizeof(GLuint), 
+                m_Meshes.size(), 
+                sizeof(DrawElementsIndirectCommand)
+            );
         }
-
-        numLightPointShadows++;
     }
 }
 
+void Render::MeshCullingPass() {
+    assert(m_MeshCullingShaderProgram);
+
+    m_MeshCullingShaderProgram->Use();
+
+    assert(m_CameraBuffer);
+    assert(m_CulledDrawIndirectBuffer);
+    assert(m_DrawIndirectBuffer);
+    assert(m_MeshBuffer);
+
+    m_CameraBuffer->BindStorage(0);
+    m_MeshBuffer->BindStorage(1);
+    m_DrawIndirectBuffer->BindStorage(2);
+    m_CulledDrawIndirectBuffer->BindStorage(3);
+
+    // Last Hi-Z holds the previous frame's pyramid, it's only usable once it exists with the same depth convention
+    const auto enableOcclusionCulling = m_EnableOcclusionCulling && m_IsHistoryValid && m_LastEnableReverseZ == m_EnableReverseZ;
+
+    assert(m_DepthTexture2D);
+    assert(m_LastHiZTexture2D);
+
+    m_LastHiZTexture2D->Bind(0, m_SamplerClamp.get());
+
+    m_MeshCullingShaderProgram->SetUniform(0, m_EnableFrustumCulling);
+    m_MeshCullingShaderProgram->SetUniform(1, enableOcclusionCulling);
+    m_MeshCullingShaderProgram->SetUniform(2, m_EnableReverseZ);
+    m_MeshCullingShaderProgram->SetUniform(3, static_cast<std::uint32_t>(m_Meshes.size()));
+    m_MeshCullingShaderProgram->SetUniform(4, m_LodThreshold);
+
+    glDispatchCompute((m_Meshes.size() + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void Render::MeshletCullingPass() {
+    assert(m_MeshletCullingShaderProgram);
+
+    m_MeshletCullingShaderProgram->Use();
+
+    assert(m_CameraBuffer);
+    assert(m_CulledDrawIndirectBuffer);
+    assert(m_MeshletBuffer);
+    assert(m_MeshletDrawCountBuffer);
+    assert(m_MeshletDrawIndirectBuffer);
+
+    m_MeshletDrawCountBuffer->Clear();
+
+    m_CameraBuffer->BindStorage(0);
+    m_MeshletBuffer->BindStorage(1);
+    m_CulledDrawIndirectBuffer->BindStorage(2);
+    m_MeshletDrawIndirectBuffer->BindStorage(3);
+    m_MeshletDrawCountBuffer->BindStorage(4);
+
+    const auto enableOcclusionCulling = m_EnableOcclusionCulling && m_IsHistoryValid && m_LastEnableReverseZ == m_EnableReverseZ;
+    const auto numMeshlets = static_cast<std::uint32_t>(m_MeshletBuffer->m_Count);
+
+    assert(m_LastHiZTexture2D);
+
+    m_LastHiZTexture2D->Bind(0, m_SamplerClamp.get());
+
+    m_MeshletCullingShaderProgram->SetUniform(0, m_EnableFrustumCulling);
+    m_MeshletCullingShaderProgram->SetUniform(1, enableOcclusionCulling);
+    m_MeshletCullingShaderProgram->SetUniform(2, m_EnableReverseZ);
+    m_MeshletCullingShaderProgram->SetUniform(3, numMeshlets);
+    m_MeshletCullingShaderProgram->SetUniform(4, m_EnableConeCulling);
+
+    glDispatchCompute((numMeshlets + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // Both culling passes have seen the last frame's depth convention now
+    m_LastEnableReverseZ = m_EnableReverseZ;
+}
+
 void Render::DepthPass() {
     assert(m_DepthFramebuffer);
     assert(m_DepthShaderProgram);
@@ -722,59 +1335,58 @@ void Render::DepthPass() {
     glDepthMask(true);
     glFrontFace(GL_CCW);
     glPolygonMode(GL_FRONT_AND_BACK, m_EnableWireframeMode ? GL_LINE : GL_FILL);
-    glScissor(0, 0, m_DepthTexture2D->m_Extent.x, m_DepthTexture2D->m_Extent.y);
-    glViewport(0, 0, m_DepthTexture2D->m_Extent.x, m_DepthTexture2D->m_Extent.y);
+    glScissor(0, 0, m_RenderExtent.x, m_RenderExtent.y);
+    glViewport(0, 0, m_RenderExtent.x, m_RenderExtent.y);
+
+    assert(m_VelocityTexture2D);
 
+    m_DepthFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_VelocityTexture2D.get());
     m_DepthFramebuffer->SetAttachment(GL_DEPTH_ATTACHMENT, m_DepthTexture2D.get());
+    m_DepthFramebuffer->ClearColor(0, glm::vec4(0.f));
     m_DepthFramebuffer->ClearDepth(0, m_EnableReverseZ ? 0.f : 1.f);
 
     assert(m_CameraBuffer);
-    assert(m_DrawIndirectBuffer);
     assert(m_IndexBuffer);
-    assert(m_VertexBuffer);
-
-    m_DrawIndirectBuffer->BindIndirect();
+    assert(m_MeshBuffer);
+    assert(m_MeshletDrawCountBuffer);
+    assert(m_MeshletDrawIndirectBuffer);
+    assert(m_PositionBuffer);
+
+    m_MeshletDrawCountBuffer->BindParameter();
+    m_MeshletDrawIndirectBuffer->BindIndirect();
+    m_IndexBuffer->BindElement();
     m_CameraBuffer->BindStorage(0);
-    m_IndexBuffer->BindStorage(1);
-    m_VertexBuffer->BindStorage(2);
+    m_PositionBuffer->BindStorage(2);
+    m_MeshBuffer->BindStorage(3);
 
-    glMultiDrawArraysIndirect(GL_TRIANGLES, 0, m_Meshes.size(), sizeof(DrawIndirectCommand));
+    glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, 0, 0, m_MeshletDrawIndirectBuffer->m_Count, sizeof(DrawElementsIndirectCommand));
 }
 
 void Render::DownsampleDepthPass() {
-    assert(m_DownsampleDepthFramebuffer);
     assert(m_DownsampleDepthShaderProgram);
 
-    m_DownsampleDepthFramebuffer->Bind();
     m_DownsampleDepthShaderProgram->Use();
-    
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_ALWAYS);
-    glDepthMask(true);
-    glFrontFace(GL_CCW);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-    m_DownsampleDepthShaderProgram->SetUniform(0, m_EnableReverseZ);
 
     assert(m_DepthTexture2D);
+    assert(m_DownsampleDepthCounterBuffer);
+    assert(m_HiZTexture2D);
 
-    auto height = m_DepthTexture2D->m_Extent.y;
-    auto width = m_DepthTexture2D->m_Extent.x;
-
-    for (auto i = 0u; i < m_DepthTexture2D->m_MipLevel - 1; i++) {
-        width /= 2;
-        height /= 2;
+    m_DownsampleDepthCounterBuffer->Clear();
+    m_DownsampleDepthCounterBuffer->BindStorage(0);
 
-        glScissor(0, 0, width, height);
-        glViewport(0, 0, width, height);
+    m_DepthTexture2D->Bind(0, m_SamplerClamp.get());
 
-        m_DownsampleDepthFramebuffer->SetAttachment(GL_DEPTH_ATTACHMENT, m_DepthTextureView2Ds.at(i + 1).get());
+    for (auto i = 0u; i < m_HiZTexture2D->m_MipLevel; i++) {
+        m_HiZTexture2D->BindImage(i, i, GL_READ_WRITE);
+    }
 
-        m_DepthTextureView2Ds.at(i + 0)->Bind(0, m_SamplerClamp.get());
+    m_DownsampleDepthShaderProgram->SetUniform(0, m_EnableReverseZ);
+    m_DownsampleDepthShaderProgram->SetUniform(1, m_HiZTexture2D->m_MipLevel);
+    m_DownsampleDepthShaderProgram->SetUniform(2, glm::ivec2(m_RenderExtent));
 
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    }
+    // Every work group reduces a 64x64 depth tile, the last one to finish builds the tail levels
+    glDispatchCompute((m_RenderExtent.x + 63) / 64, (m_RenderExtent.y + 63) / 64, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 }
 
 void Render::AmbientOcclusionPass() {
@@ -787,16 +1399,34 @@ void Render::AmbientOcclusionPass() {
     glDisable(GL_CULL_FACE);
     glDisable(GL_DEPTH_TEST);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glScissor(0, 0, m_AmbientOcclusionTexture2D->m_Extent.x, m_AmbientOcclusionTexture2D->m_Extent.y);
-    glViewport(0, 0, m_AmbientOcclusionTexture2D->m_Extent.x, m_AmbientOcclusionTexture2D->m_Extent.y);
 
-    m_AmbientOcclusionFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_AmbientOcclusionTexture2D.get());
+    assert(m_AmbientOcclusionTexture2D);
+
+    // Reduced resolutions trace against the Hi-Z level of the same size
+    const auto level = static_cast<GLuint>(m_AmbientOcclusionResolution);
+
+    // Interleaved tracing writes one sample per 2x2 block into the next mip
+    const auto targetLevel = m_EnableAmbientOcclusionInterleaving ? level + 1 : level;
+    const auto extent = ComputeMipExtent(m_RenderExtent, targetLevel);
+
+    glScissor(0, 0, extent.x, extent.y);
+    glViewport(0, 0, extent.x, extent.y);
+
+    m_AmbientOcclusionFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_AmbientOcclusionTextureView2Ds.at(targetLevel).get());
 
     assert(m_CameraBuffer);
 
     m_CameraBuffer->BindStorage(0);
 
-    m_DepthTextureView2Ds.at(0)->Bind(0, m_SamplerClamp.get());
+    assert(m_DepthTexture2D);
+
+    if (level > 0) {
+        m_HiZTextureView2Ds.at(level - 1)->Bind(0, m_SamplerClamp.get());
+    } else {
+        m_DepthTexture2D->Bind(0, m_SamplerClamp.get());
+    }
+
+    m_HiZTextureView2Ds.at(std::max(level, 1u) - 1)->Bind(1, m_SamplerClamp.get());
 
     constexpr auto OFFSETS = std::array<float, 4> { 0.0f, 0.5f, 0.25f, 0.75f };
     constexpr auto ROTATIONS = std::array<float, 6> { 60.f, 300.f, 180.f, 240.f, 120.f, 0.f };
@@ -808,6 +1438,9 @@ void Render::AmbientOcclusionPass() {
     m_AmbientOcclusionShaderProgram->SetUniform(4, OFFSETS[m_NumFrames / 6 % OFFSETS.size()]);
     m_AmbientOcclusionShaderProgram->SetUniform(5, m_AmbientOcclusionRadius);
     m_AmbientOcclusionShaderProgram->SetUniform(6, ROTATIONS[m_NumFrames % 6] / 360.f);
+    m_AmbientOcclusionShaderProgram->SetUniform(7, m_EnableAmbientOcclusionInterleaving);
+    m_AmbientOcclusionShaderProgram->SetUniform(8, ComputeInterleaveOffset(m_NumFrames));
+    m_AmbientOcclusionShaderProgram->SetUniform(9, level);
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
@@ -822,21 +1455,35 @@ void Render::AmbientOcclusionSpartialPass() {
     glDisable(GL_CULL_FACE);
     glDisable(GL_DEPTH_TEST);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glScissor(0, 0, m_AmbientOcclusionSpartialTexture2D->m_Extent.x, m_AmbientOcclusionSpartialTexture2D->m_Extent.y);
-    glViewport(0, 0, m_AmbientOcclusionSpartialTexture2D->m_Extent.x, m_AmbientOcclusionSpartialTexture2D->m_Extent.y);
 
-    m_AmbientOcclusionSpartialFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_AmbientOcclusionSpartialTexture2D.get());
+    assert(m_AmbientOcclusionSpartialTexture2D);
+
+    const auto level = static_cast<GLuint>(m_AmbientOcclusionResolution);
+    const auto extent = ComputeMipExtent(m_RenderExtent, level);
+
+    glScissor(0, 0, extent.x, extent.y);
+    glViewport(0, 0, extent.x, extent.y);
+
+    m_AmbientOcclusionSpartialFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_AmbientOcclusionSpartialTextureView2Ds.at(level).get());
 
     assert(m_CameraBuffer);
 
     m_CameraBuffer->BindStorage(0);
 
-    assert(m_AmbientOcclusionTexture2D);
+    assert(m_DepthTexture2D);
 
-    m_AmbientOcclusionTexture2D->Bind(0, m_SamplerClamp.get());
-    m_DepthTextureView2Ds.at(0)->Bind(1, m_SamplerClamp.get());
+    m_AmbientOcclusionTextureView2Ds.at(m_EnableAmbientOcclusionInterleaving ? level + 1 : level)->Bind(0, m_SamplerClamp.get());
+
+    if (level > 0) {
+        m_HiZTextureView2Ds.at(level - 1)->Bind(1, m_SamplerClamp.get());
+    } else {
+        m_DepthTexture2D->Bind(1, m_SamplerClamp.get());
+    }
 
-    m_AmbientOcclusionSpartialShaderProgram->SetUniform(0, m_EnableAmbientOcclusion);
+    m_AmbientOcclusionSpartialShaderProgram->SetUniform(0, m_EnableReverseZ);
+    m_AmbientOcclusionSpartialShaderProgram->SetUniform(1, m_EnableAmbientOcclusionInterleaving);
+    m_AmbientOcclusionSpartialShaderProgram->SetUniform(2, ComputeInterleaveOffset(m_NumFrames));
+    m_AmbientOcclusionSpartialShaderProgram->SetUniform(3, level);
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
@@ -851,27 +1498,50 @@ void Render::AmbientOcclusionTemporalPass() {
     glDisable(GL_CULL_FACE);
     glDisable(GL_DEPTH_TEST);
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glScissor(0, 0, m_AmbientOcclusionTemporalTexture2D->m_Extent.x, m_AmbientOcclusionTemporalTexture2D->m_Extent.y);
-    glViewport(0, 0, m_AmbientOcclusionTemporalTexture2D->m_Extent.x, m_AmbientOcclusionTemporalTexture2D->m_Extent.y);
+
+    assert(m_AmbientOcclusionTemporalTexture2D);
+
+    const auto level = static_cast<GLuint>(m_AmbientOcclusionResolution);
+    const auto extent = ComputeMipExtent(m_RenderExtent, level);
+
+    glScissor(0, 0, extent.x, extent.y);
+    glViewport(0, 0, extent.x, extent.y);
     
-    m_AmbientOcclusionTemporalFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_AmbientOcclusionTemporalTexture2D.get());
+    m_AmbientOcclusionTemporalFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_AmbientOcclusionTemporalTextureView2Ds.at(level).get());
 
     assert(m_CameraBuffer);
 
     m_CameraBuffer->BindStorage(0);
 
-    assert(m_AmbientOcclusionSpartialTexture2D);
-    assert(m_LastAmbientOcclusionTemporalTexture2D);
+    m_AmbientOcclusionSpartialTextureView2Ds.at(level)->Bind(0, m_SamplerClamp.get());
+    m_HiZTextureView2Ds.at(std::max(level, 1u) - 1)->Bind(1, m_SamplerClamp.get());
+    m_LastAmbientOcclusionTemporalTextureView2Ds.at(level)->Bind(2, m_SamplerClamp.get());
+    m_LastHiZTextureView2Ds.at(std::max(level, 1u) - 1)->Bind(3, m_SamplerClamp.get());
+
+    assert(m_VelocityTexture2D);
+
+    m_VelocityTexture2D->Bind(4, m_SamplerClamp.get());
 
-    m_AmbientOcclusionSpartialTexture2D->Bind(0, m_SamplerClamp.get());
-    m_DepthTextureView2Ds.at(1)->Bind(1, m_SamplerClamp.get());
-    m_LastAmbientOcclusionTemporalTexture2D->Bind(2, m_SamplerClamp.get());
-    m_LastDepthTextureView2Ds.at(1)->Bind(3, m_SamplerClamp.get());
+    // History of another level or tracing mode was never written or is stale, so it starts over
+    const auto enableHistory = m_IsHistoryValid
+        && m_LastAmbientOcclusionResolution == m_AmbientOcclusionResolution
+        && m_LastEnableAmbientOcclusionInterleaving == m_EnableAmbientOcclusionInterleaving;
+
+    m_AmbientOcclusionTemporalShaderProgram->SetUniform(0, m_EnableAmbientOcclusionInterleaving);
+    m_AmbientOcclusionTemporalShaderProgram->SetUniform(1, level);
+    m_AmbientOcclusionTemporalShaderProgram->SetUniform(2, enableHistory);
    
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    m_LastAmbientOcclusionResolution = m_AmbientOcclusionResolution;
+    m_LastEnableAmbientOcclusionInterleaving = m_EnableAmbientOcclusionInterleaving;
 }
 
 void Render::ClusterPass() {
+    if (!m_ClusterUpdate) {
+        return;
+    }
+
     assert(m_ClusterShaderProgram);
     
     m_ClusterShaderProgram->Use();
@@ -882,8 +1552,12 @@ void Render::ClusterPass() {
     m_CameraBuffer->BindStorage(0);
     m_ClusterBuffer->BindStorage(1);
 
-    glDispatchCompute(GRID_SIZE_X, GRID_SIZE_Y, GRID_SIZE_Z);
+    m_ClusterShaderProgram->SetUniform(0, m_ClusterGridSize);
+
+    glDispatchCompute(m_ClusterGridSize.x, m_ClusterGridSize.y, m_ClusterGridSize.z);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    m_ClusterUpdate = false;
 }
 
 void Render::LightCullingPass() {
@@ -906,9 +1580,23 @@ void Render::LightCullingPass() {
     m_LightPointBuffer->BindStorage(5);
 
     m_LightCullingShaderProgram->SetUniform(0, static_cast<std::uint32_t>(m_DrawableLightPoints.size()));
+    m_LightCullingShaderProgram->SetUniform(1, static_cast<std::uint32_t>(m_LightIndexBuffer->m_Count));
+    m_LightCullingShaderProgram->SetUniform(2, m_ClusterGridSize);
 
-    glDispatchCompute(GRID_SIZE_X, GRID_SIZE_Y, GRID_SIZE_Z);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    // Each workgroup culls 64 consecutive clusters
+    glDispatchCompute((m_ClusterGridSize.x * m_ClusterGridSize.y * m_ClusterGridSize.z + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    // Keep the total for a later frame to size the index list, a slot still in flight is overwritten
+    auto &lightCounterFence = m_LightCounterFences[m_NumFrames % m_LightCounterFences.size()];
+
+    if (lightCounterFence) {
+        glDeleteSync(lightCounterFence);
+    }
+
+    m_LightCounterBuffer->Copy(m_LightCounterReadbackBuffer.get(), 0, m_NumFrames % m_LightCounterFences.size(), 1);
+
+    lightCounterFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
 
 void Render::LightingPass() {
@@ -927,8 +1615,8 @@ void Render::LightingPass() {
     glDepthMask(false);
     glFrontFace(GL_CCW);
     glPolygonMode(GL_FRONT_AND_BACK, m_EnableWireframeMode ? GL_LINE : GL_FILL);
-    glScissor(0, 0, m_LightingTexture2D->m_Extent.x, m_LightingTexture2D->m_Extent.y);
-    glViewport(0, 0, m_LightingTexture2D->m_Extent.x, m_LightingTexture2D->m_Extent.y);
+    glScissor(0, 0, m_RenderExtent.x, m_RenderExtent.y);
+    glViewport(0, 0, m_RenderExtent.x, m_RenderExtent.y);
 
     assert(m_DepthTexture2D);
 
@@ -936,6 +1624,7 @@ void Render::LightingPass() {
     m_LightingFramebuffer->SetAttachment(GL_DEPTH_ATTACHMENT, m_DepthTexture2D.get());
     m_LightingFramebuffer->ClearColor(0, glm::vec4(glm::vec3(0.f), 1.f));
 
+    assert(m_AttributeBuffer);
     assert(m_CameraBuffer);
     assert(m_IndexBuffer);
     assert(m_LightEnvironmentBuffer);
@@ -943,17 +1632,25 @@ void Render::LightingPass() {
     assert(m_LightIndexBuffer);
     assert(m_LightPointBuffer);
     assert(m_MaterialBuffer);
-    assert(m_VertexBuffer);
-
-    m_DrawIndirectBuffer->BindIndirect();
+    assert(m_MeshBuffer);
+    assert(m_MeshletDrawCountBuffer);
+    assert(m_MeshletDrawIndirectBuffer);
+    assert(m_PositionBuffer);
+    assert(m_ShadowCubeBuffer);
+
+    m_MeshletDrawCountBuffer->BindParameter();
+    m_MeshletDrawIndirectBuffer->BindIndirect();
+    m_IndexBuffer->BindElement();
     m_CameraBuffer->BindStorage(0);
-    m_IndexBuffer->BindStorage(1);
     m_LightEnvironmentBuffer->BindStorage(2);
     m_LightGridBuffer->BindStorage(3);
     m_LightIndexBuffer->BindStorage(4);
     m_LightPointBuffer->BindStorage(5);
     m_MaterialBuffer->BindStorage(6);
-    m_VertexBuffer->BindStorage(7);
+    m_PositionBuffer->BindStorage(7);
+    m_ShadowCubeBuffer->BindStorage(8);
+    m_AttributeBuffer->BindStorage(9);
+    m_MeshBuffer->BindStorage(10);
 
     assert(m_AmbientOcclusionTemporalTexture2D);
     assert(m_DiffuseTexture2DArray);
@@ -962,28 +1659,74 @@ void Render::LightingPass() {
     assert(m_RoughnessTexture2DArray);
     assert(m_ShadowCsmColorTexture2DArray);
     assert(m_ShadowCsmDepthTexture2DArray);
-    assert(m_ShadowCubeColorTextureCubeArray);
-    assert(m_ShadowCubeDepthTextureCubeArray);
+    assert(m_ShadowCubeColorTexture2D);
+    assert(m_ShadowCubeDepthTexture2D);
 
-    m_AmbientOcclusionTemporalTexture2D->Bind(0, m_SamplerClamp.get());
+    const auto ambientOcclusionLevel = static_cast<GLuint>(m_AmbientOcclusionResolution);
+
+    m_AmbientOcclusionTemporalTextureView2Ds.at(ambientOcclusionLevel)->Bind(0, m_SamplerClamp.get());
     m_DiffuseTexture2DArray->Bind(1, m_SamplerWrap.get());
     m_MetalnessTexture2DArray->Bind(2, m_SamplerWrap.get());
     m_NormalTexture2DArray->Bind(3, m_SamplerWrap.get());
     m_RoughnessTexture2DArray->Bind(4, m_SamplerWrap.get());
     m_ShadowCsmColorTexture2DArray->Bind(5, m_SamplerBorderWhite.get());
     m_ShadowCsmDepthTexture2DArray->Bind(6, m_SamplerBorderWhite.get());
-    m_ShadowCubeColorTextureCubeArray->Bind(7, m_SamplerClamp.get());  
-    m_ShadowCubeDepthTextureCubeArray->Bind(8, m_SamplerClamp.get());  
+    m_ShadowCubeColorTexture2D->Bind(7, m_SamplerClamp.get());  
+    m_ShadowCubeDepthTexture2D->Bind(8, m_SamplerClamp.get());  
+    m_HiZTextureView2Ds.at(std::max(ambientOcclusionLevel, 1u) - 1)->Bind(9, m_SamplerClamp.get());
 
     m_LightingShaderProgram->SetUniform(0, m_EnableAmbientOcclusion);
     m_LightingShaderProgram->SetUniform(1, m_EnableReverseZ);
     m_LightingShaderProgram->SetUniform(2, static_cast<std::uint32_t>(m_DrawableLightPoints.size()));
     m_LightingShaderProgram->SetUniform(3, 1.f / SHADOW_CSM_SIZE * m_ShadowCsmFilterRadius);
     m_LightingShaderProgram->SetUniform(4, m_ShadowCsmVarianceMax);
-    m_LightingShaderProgram->SetUniform(5, 1.f / SHADOW_CUBE_SIZE * m_ShadowCubeFilterRadius);
+    m_LightingShaderProgram->SetUniform(5, m_ShadowCubeFilterRadius);
     m_LightingShaderProgram->SetUniform(6, m_ShadowCubeVarianceMax);
+    m_LightingShaderProgram->SetUniform(7, m_ClusterGridSize);
+    m_LightingShaderProgram->SetUniform(8, ambientOcclusionLevel);
     
-    glMultiDrawArraysIndirect(GL_TRIANGLES, 0, m_Meshes.size(), sizeof(DrawIndirectCommand));
+    glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, 0, 0, m_MeshletDrawIndirectBuffer->m_Count, sizeof(DrawElementsIndirectCommand));
+}
+
+void Render::UpscalePass() {
+    // Native resolution frames are shown as they are
+    if (m_RenderExtent == m_ScreenExtent) {
+        return;
+    }
+
+    assert(m_UpscaleFramebuffer);
+    assert(m_UpscaleShaderProgram);
+
+    m_UpscaleFramebuffer->Bind();
+    m_UpscaleShaderProgram->Use();
+
+    assert(m_UpscaleTexture2D);
+
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glScissor(0, 0, m_UpscaleTexture2D->m_Extent.x, m_UpscaleTexture2D->m_Extent.y);
+    glViewport(0, 0, m_UpscaleTexture2D->m_Extent.x, m_UpscaleTexture2D->m_Extent.y);
+
+    m_UpscaleFramebuffer->SetAttachment(GL_COLOR_ATTACHMENT0, m_UpscaleTexture2D.get());
+
+    assert(m_CameraBuffer);
+
+    m_CameraBuffer->BindStorage(0);
+
+    assert(m_LastUpscaleTexture2D);
+    assert(m_LightingTexture2D);
+    assert(m_VelocityTexture2D);
+
+    m_LightingTexture2D->Bind(0, m_SamplerClamp.get());
+    m_LastUpscaleTexture2D->Bind(1, m_SamplerClamp.get());
+    m_VelocityTexture2D->Bind(2, m_SamplerClamp.get());
+
+    // History only exists when the last frame was upscaled as well
+    m_UpscaleShaderProgram->SetUniform(0, m_IsHistoryValid && m_LastRenderExtent != m_ScreenExtent);
+    m_UpscaleShaderProgram->SetUniform(1, m_Jitter);
+
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
 
 void Render::ScreenPass() {
@@ -1000,19 +1743,31 @@ void Render::ScreenPass() {
 
     assert(m_AmbientOcclusionTemporalTexture2D);
     assert(m_LightingTexture2D);
+    assert(m_UpscaleTexture2D);
+
+    const auto level = static_cast<GLuint>(m_AmbientOcclusionResolution);
+
+    // Targets rendered at the scaled extent only fill part of their texture
+    auto texcoordScale = glm::vec2(1.f);
 
     switch (m_DrawFlags) {
         case DrawFlags::AmbientOcclusion:
-            m_AmbientOcclusionTemporalTexture2D->Bind(0, m_SamplerClamp.get());
+            m_AmbientOcclusionTemporalTextureView2Ds.at(level)->Bind(0, m_SamplerClamp.get());
+            texcoordScale = glm::vec2(ComputeMipExtent(m_RenderExtent, level)) / glm::vec2(ComputeMipExtent(m_ScreenExtent, level));
             break;
         case DrawFlags::Lighting:
-            m_LightingTexture2D->Bind(0, m_SamplerClamp.get());
+            if (m_RenderExtent != m_ScreenExtent) {
+                m_UpscaleTexture2D->Bind(0, m_SamplerClamp.get());
+            } else {
+                m_LightingTexture2D->Bind(0, m_SamplerClamp.get());
+            }
             break;
         default:
             break;
     }
 
     m_ScreenShaderProgram->SetUniform(0, static_cast<std::uint32_t>(m_DrawFlags));
+    m_ScreenShaderProgram->SetUniform(1, texcoordScale);
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
\ No newline at end of file
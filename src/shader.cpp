@@ -56,6 +56,14 @@ void ShaderProgram::SetUniform(GLuint location, const glm::vec4 &value) const {
     glProgramUniform4fv(m_Handle, location, 1, reinterpret_cast<const float *>(&value));
 }
 
+void ShaderProgram::SetUniform(GLuint location, const glm::ivec2 &value) const {
+    glProgramUniform2iv(m_Handle, location, 1, reinterpret_cast<const GLint *>(&value));
+}
+
+void ShaderProgram::SetUniform(GLuint location, const glm::uvec3 &value) const {
+    glProgramUniform3uiv(m_Handle, location, 1, reinterpret_cast<const GLuint *>(&value));
+}
+
 void ShaderProgram::Use() const {
     glUseProgram(m_Handle);
 }
\ No newline at end of file
@@ -3,4 +3,5 @@
 float g_CurrentTime = 0.f;
 float g_DeltaTime = 0.f;
 float g_PreviousTime = 0.f;
+std::filesystem::path g_CachePath = std::filesystem::path("cache");
 std::filesystem::path g_ResourcePath = std::filesystem::path("resources");
\ No newline at end of file
@@ -39,6 +39,10 @@ void Texture::Bind(GLuint binding, const Sampler *sampler) const {
     sampler->Bind(binding);
 }
 
+void Texture::BindImage(GLuint binding, GLuint level, GLenum access) const {
+    glBindImageTexture(binding, m_Handle, level, GL_FALSE, 0, access, m_Format);
+}
+
 void Texture::GenerateMipMaps() const {
     glGenerateTextureMipmap(m_Handle);
 }
@@ -139,6 +143,19 @@ void Texture2DArray::Copy(const Texture *dst, const glm::uvec3 &srcOffset, GLuin
     );
 }
 
+void Texture2DArray::Upload(const CompressedImage *upload, const glm::uvec3 &offset) const {
+    assert(m_Extent.x == upload->m_Width);
+    assert(m_Extent.y == upload->m_Height);
+
+    // Mips come precomputed with the image
+    for (auto level = 0u; level < std::min(m_MipLevel, upload->MipLevel()); level++) {
+        const auto width = std::max(upload->m_Width >> level, 1u);
+        const auto height = std::max(upload->m_Height >> level, 1u);
+
+        glCompressedTextureSubImage3D(m_Handle, level, offset.x, offset.y, offset.z, width, height, 1, m_Format, upload->LevelSize(level), upload->Level(level));
+    }
+}
+
 void Texture2DArray::Upload(const Image *upload, const glm::uvec3 &offset, GLuint level) const {
     auto [format, internalFormat, type] = FindImageFormat(upload);
     auto mipLevel = upload->MipLevel();
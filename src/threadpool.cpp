@@ -0,0 +1,92 @@
+#include <atomic>
+
+#include "threadpool.hpp"
+
+std::shared_ptr<ThreadPool> g_ThreadPool = nullptr;
+
+struct ParallelForState {
+    std::condition_variable m_Condition;
+    std::atomic<size_t>     m_Done;
+    std::mutex              m_Mutex;
+    std::atomic<size_t>     m_Next;
+};
+
+ThreadPool::ThreadPool(unsigned int numThreads) {
+    m_Quit = false;
+
+    for (auto i = 0u; i < numThreads; i++) {
+        m_Threads.push_back(std::thread(&ThreadPool::Work, this));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        auto lock = std::unique_lock(m_Mutex);
+
+        m_Quit = true;
+    }
+
+    m_Condition.notify_all();
+
+    for (auto &thread : m_Threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)> &function) {
+    // Workers pull indices until they run out, tasks which start late find nothing left and never touch the function
+    auto state = std::make_shared<ParallelForState>();
+
+    state->m_Done = 0;
+    state->m_Next = 0;
+
+    const auto work = [state, count, &function]() {
+        for (auto i = state->m_Next++; i < count; i = state->m_Next++) {
+            function(i);
+
+            if (++state->m_Done == count) {
+                auto lock = std::unique_lock(state->m_Mutex);
+
+                state->m_Condition.notify_all();
+            }
+        }
+    };
+
+    {
+        auto lock = std::unique_lock(m_Mutex);
+
+        for (auto i = 1u; i < std::min(count, m_Threads.size() + 1); i++) {
+            m_Tasks.push_back(work);
+        }
+    }
+
+    m_Condition.notify_all();
+
+    // Calling thread helps as well, so nested calls can't starve
+    work();
+
+    auto lock = std::unique_lock(state->m_Mutex);
+
+    state->m_Condition.wait(lock, [state, count]() { return state->m_Done == count; });
+}
+
+void ThreadPool::Work() {
+    while (true) {
+        auto task = std::function<void()>();
+
+        {
+            auto lock = std::unique_lock(m_Mutex);
+
+            m_Condition.wait(lock, [this]() { return m_Quit || !m_Tasks.empty(); });
+
+            if (m_Quit && m_Tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+
+        task();
+    }
+}
\ No newline at end of file
@@ -33,8 +33,14 @@ Ui::Ui() {
 }
 
 Ui::~Ui() {
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplSDL2_Shutdown();
+    // Backends are only initialized when there is a window to draw into
+    if (ImGui::GetIO().BackendRendererUserData) {
+        ImGui_ImplOpenGL3_Shutdown();
+    }
+    if (ImGui::GetIO().BackendPlatformUserData) {
+        ImGui_ImplSDL2_Shutdown();
+    }
+
     ImGui::DestroyContext();
 }
 
@@ -60,11 +66,41 @@ void Ui::Update(const std::vector<SDL_Event> &events) {
             ImGui::Text("FPS: %s", framerate.c_str());
             ImGui::Spacing();
 
+            // GPU time of every pass, rolling over the last frames
+            if (ImGui::BeginTable("Profiler", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("Pass");
+                ImGui::TableSetupColumn("Min, ms");
+                ImGui::TableSetupColumn("Avg, ms");
+                ImGui::TableSetupColumn("P99, ms");
+                ImGui::TableHeadersRow();
+
+                for (const auto &statistics : g_Render->m_Profiler->Statistics()) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", statistics.m_Name);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", statistics.m_Min);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", statistics.m_Avg);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", statistics.m_P99);
+                }
+
+                ImGui::EndTable();
+            }
+
+            ImGui::Spacing();
+
             // Global
             ImGui::Checkbox("Enable Ambient Occlusion", &g_Render->m_EnableAmbientOcclusion);
+            ImGui::Checkbox("Enable Cone Culling", &g_Render->m_EnableConeCulling);
+            ImGui::Checkbox("Enable Frustum Culling", &g_Render->m_EnableFrustumCulling);
+            ImGui::Checkbox("Enable Occlusion Culling", &g_Render->m_EnableOcclusionCulling);
             ImGui::Checkbox("Enable Reverse Z", &g_Render->m_EnableReverseZ);
             ImGui::Checkbox("Enable VSync", &g_Render->m_EnableVSync);
             ImGui::Checkbox("Enable Wireframe Mode", &g_Render->m_EnableWireframeMode);
+            ImGui::SliderFloat("LOD threshold", &g_Render->m_LodThreshold, 0.f, 8.f, "%.1f px");
+            ImGui::SliderFloat("Render scale", &g_Render->m_RenderScale, 0.5f, 1.f, "%.2f");
             ImGui::Spacing();
 
             auto drawAo = static_cast<bool>(g_Render->m_DrawFlags & DrawFlags::AmbientOcclusion);
@@ -79,12 +115,46 @@ void Ui::Update(const std::vector<SDL_Event> &events) {
 
             // Ambient Occlusion
             ImGui::SeparatorText("Ambient Occlusion");
+            ImGui::Checkbox("Enable Interleaving##AO", &g_Render->m_EnableAmbientOcclusionInterleaving);
             ImGui::DragFloat("Falloff Far##AO", &g_Render->m_AmbientOcclusionFalloffFar);
             ImGui::DragFloat("Falloff Near##AO", &g_Render->m_AmbientOcclusionFalloffNear);
             ImGui::DragFloat("Radius##AO", &g_Render->m_AmbientOcclusionRadius);
             ImGui::DragInt("Num samples##AO", &g_Render->m_AmbientOcclusionNumSamples, 1.f, 1);
             ImGui::DragInt("Num slices##AO", &g_Render->m_AmbientOcclusionNumSlices, 1.f, 1);
 
+            const auto resolution = g_Render->m_AmbientOcclusionResolution;
+
+            if (ImGui::RadioButton("Full##AO", resolution == AmbientOcclusionResolution::Full)) {
+                g_Render->m_AmbientOcclusionResolution = AmbientOcclusionResolution::Full;
+            }
+            ImGui::SameLine();
+            if (ImGui::RadioButton("Half##AO", resolution == AmbientOcclusionResolution::Half)) {
+                g_Render->m_AmbientOcclusionResolution = AmbientOcclusionResolution::Half;
+            }
+            ImGui::SameLine();
+            if (ImGui::RadioButton("Quarter##AO", resolution == AmbientOcclusionResolution::Quarter)) {
+                g_Render->m_AmbientOcclusionResolution = AmbientOcclusionResolution::Quarter;
+            }
+
+            // Dynamic Resolution
+            ImGui::SeparatorText("Dynamic Resolution");
+            ImGui::Checkbox("Enable##DynamicResolution", &g_Render->m_EnableDynamicResolution);
+            ImGui::SliderFloat("Target frame time##DynamicResolution", &g_Render->m_TargetFrameTime, 1.f, 33.3f, "%.2f ms");
+
+            // Clusters
+            ImGui::SeparatorText("Clusters");
+            ImGui::Checkbox("Enable Auto Grid Size##Clusters", &g_Render->m_EnableAutoClusterGridSize);
+
+            if (!g_Render->m_EnableAutoClusterGridSize) {
+                // Same per-axis limits the renderer clamps the grid to
+                const auto gridSizeMin = 1u;
+                const auto gridSizeMaxXY = 64u;
+                const auto gridSizeMaxZ = 32u;
+
+                ImGui::DragScalarN("Grid size XY##Clusters", ImGuiDataType_U32, &g_Render->m_ClusterGridSize.x, 2, 1.f, &gridSizeMin, &gridSizeMaxXY);
+                ImGui::DragScalarN("Grid size Z##Clusters", ImGuiDataType_U32, &g_Render->m_ClusterGridSize.z, 1, 1.f, &gridSizeMin, &gridSizeMaxZ);
+            }
+
             // Light objects
             if (m_LightEnvironment) {
                 const auto lightEnvironmentName = std::string("LightEnvironment") ;
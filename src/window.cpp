@@ -1,30 +1,115 @@
+#include <cstring>
 #include <iostream>
 
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
 #include "window.hpp"
 
 std::shared_ptr<Window> g_Window = nullptr;
 
-Window::Window(unsigned int height, unsigned int width) {
+static EGLDisplay GetOffscreenDisplay() {
+    auto display = EGL_NO_DISPLAY;
+
+    // Prefer the surfaceless platform, it doesn't need a running display server
+    const auto extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    const auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+    if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless") && getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    return display;
+}
+
+Window::Window(unsigned int height, unsigned int width, bool offscreen) {
+    m_Config = nullptr;
+    m_Display = EGL_NO_DISPLAY;
     m_ScreenHeight = height;
     m_ScreenWidth = width;
-    m_Window = SDL_CreateWindow(
-        "cg", 
-        SDL_WINDOWPOS_CENTERED, 
-        SDL_WINDOWPOS_CENTERED, 
-        width, 
-        height,
-        SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN
-    );
-
-    if (!m_Window) {
-        std::cout << "Window could not be created. " << SDL_GetError() << std::endl;
+    m_Surface = EGL_NO_SURFACE;
+    m_Window = nullptr;
+
+    if (offscreen) {
+        m_Display = GetOffscreenDisplay();
+
+        if (m_Display != EGL_NO_DISPLAY && eglInitialize(m_Display, nullptr, nullptr)) {
+            const EGLint configAttributes[] = {
+                EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                EGL_RED_SIZE, 8,
+                EGL_GREEN_SIZE, 8,
+                EGL_BLUE_SIZE, 8,
+                EGL_NONE,
+            };
+            const EGLint surfaceAttributes[] = {
+                EGL_WIDTH, static_cast<EGLint>(width),
+                EGL_HEIGHT, static_cast<EGLint>(height),
+                EGL_NONE,
+            };
+
+            auto numConfigs = EGLint(0);
+
+            if (eglChooseConfig(m_Display, configAttributes, &m_Config, 1, &numConfigs) && numConfigs > 0) {
+                m_Surface = eglCreatePbufferSurface(m_Display, m_Config, surfaceAttributes);
+            }
+        }
+
+        if (m_Surface == EGL_NO_SURFACE) {
+            std::cout << "Offscreen surface could not be created. EGL error: " << std::hex << eglGetError() << std::dec << std::endl;
+        }
+    } else {
+        m_Window = SDL_CreateWindow(
+            "cg", 
+            SDL_WINDOWPOS_CENTERED, 
+            SDL_WINDOWPOS_CENTERED, 
+            width, 
+            height,
+            SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN
+        );
+
+        if (!m_Window) {
+            std::cout << "Window could not be created. " << SDL_GetError() << std::endl;
+        }
     }
 }
 
 Window::~Window() {
-    SDL_DestroyWindow(m_Window);
+    if (m_Window) {
+        SDL_DestroyWindow(m_Window);
+    }
+
+    if (m_Display != EGL_NO_DISPLAY) {
+        if (m_Surface != EGL_NO_SURFACE) {
+            eglDestroySurface(m_Display, m_Surface);
+        }
+
+        eglTerminate(m_Display);
+    }
+}
+
+// Only records the new size, the renderer picks it up at the next frame boundary
+void Window::Resize(unsigned int height, unsigned int width) {
+    m_ScreenHeight = height;
+    m_ScreenWidth = width;
+}
+
+void Window::ToggleFullscreen() {
+    if (m_Window) {
+        const auto isFullscreen = (SDL_GetWindowFlags(m_Window) & SDL_WINDOW_FULLSCREEN) != 0;
+
+        SDL_SetWindowFullscreen(m_Window, isFullscreen ? 0 : SDL_WINDOW_FULLSCREEN_DESKTOP);
+    }
 }
 
 void Window::Update() {
-    SDL_GL_SwapWindow(g_Window->m_Window);
+    if (m_Window) {
+        SDL_GL_SwapWindow(m_Window);
+    } else if (m_Surface != EGL_NO_SURFACE) {
+        eglSwapBuffers(m_Display, m_Surface);
+    }
 }
\ No newline at end of file